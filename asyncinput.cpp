@@ -0,0 +1,173 @@
+#include <cerrno>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include "asyncinput.h"
+
+AsyncInput::AsyncInput(int fd, size_t bufferSize, size_t bufferCount)
+        : fd(fd),
+          bufferSize(bufferSize),
+          slots(bufferCount < 2 ? 2 : bufferCount),
+          current(-1),
+          stopping(false)
+{
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+        slots[i].storage.resize(bufferSize + 1);
+        slots[i].size = 0;
+        slots[i].full = false;
+        slots[i].last = false;
+    }
+    if (pipe(wakeup) != 0)
+    {
+        wakeup[0] = wakeup[1] = -1;
+    }
+    setg(0, 0, 0);
+    reader = std::thread(&AsyncInput::readAhead, this);
+}
+
+AsyncInput::~AsyncInput()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    changed.notify_all();
+    if (wakeup[1] >= 0)
+    {
+        char ch = 0;
+        while (write(wakeup[1], &ch, 1) < 0 && errno == EINTR)
+        {
+        }
+    }
+    reader.join();
+    if (wakeup[0] >= 0)
+    {
+        close(wakeup[0]);
+        close(wakeup[1]);
+    }
+}
+
+// Reads until the buffer is full or no more input is available right now,
+// so a slow writer still gets its data to the lexer promptly
+size_t AsyncInput::fill(char *data, bool& last)
+{
+    size_t size = 0;
+    while (size < bufferSize)
+    {
+        pollfd fds[2] = { { fd, POLLIN, 0 }, { wakeup[0], POLLIN, 0 } };
+        int ready = poll(fds, wakeup[0] >= 0 ? 2 : 1, size == 0 ? -1 : 0);
+        if (ready < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (ready == 0)
+        {
+            break;
+        }
+        if (ready < 0 || (fds[1].revents & POLLIN))
+        {
+            last = true;
+            break;
+        }
+        ssize_t n = read(fd, data + size, bufferSize - size);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN))
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            last = true;
+            break;
+        }
+        size += n;
+    }
+    return size;
+}
+
+void AsyncInput::readAhead()
+{
+    for (size_t i = 0; ; i = (i + 1) % slots.size())
+    {
+        Slot& slot = slots[i];
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            while (slot.full && !stopping)
+            {
+                changed.wait(guard);
+            }
+            if (stopping)
+            {
+                return;
+            }
+        }
+        bool last = false;
+        size_t size = fill(&slot.storage[1], last);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            slot.size = size;
+            slot.last = last;
+            slot.full = true;
+        }
+        changed.notify_all();
+        if (last)
+        {
+            return;
+        }
+    }
+}
+
+AsyncInput::int_type AsyncInput::underflow()
+{
+    if (gptr() < egptr())
+    {
+        return traits_type::to_int_type(*gptr());
+    }
+    for (;;)
+    {
+        char putback = 0;
+        bool hasPutback = false;
+        int next = 0;
+        if (current >= 0)
+        {
+            Slot& done = slots[current];
+            if (done.last)
+            {
+                return traits_type::eof();
+            }
+            if (done.size > 0)
+            {
+                putback = done.storage[done.size];
+                hasPutback = true;
+            }
+            next = (current + 1) % slots.size();
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                done.full = false;
+            }
+            changed.notify_all();
+        }
+
+        Slot& slot = slots[next];
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            while (!slot.full)
+            {
+                changed.wait(guard);
+            }
+        }
+        current = next;
+        char *data = &slot.storage[1];
+        slot.storage[0] = putback;
+        setg(hasPutback ? data - 1 : data, data, data + slot.size);
+        if (slot.size > 0)
+        {
+            return traits_type::to_int_type(*gptr());
+        }
+        if (slot.last)
+        {
+            return traits_type::eof();
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef ASYNCINPUT_H_
+#define ASYNCINPUT_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+// Read-ahead input buffer for pipes and other descriptors that can't be mapped
+//
+// A reader thread fills a ring of large buffers from the descriptor while the
+// lexer scans the buffers already filled, so read() latency overlaps with
+// lexing. Characters are taken straight from the current buffer by the inline
+// streambuf fast path; the reader and the lexer only synchronize when the
+// lexer moves on to the next buffer. One character of putback is kept across
+// buffer boundaries, which is all getToken ever puts back.
+class AsyncInput : public std::streambuf
+{
+public:
+    explicit AsyncInput(int fd, size_t bufferSize = 1 << 20, size_t bufferCount = 4);
+    ~AsyncInput();
+
+protected:
+    virtual int_type underflow();
+
+private:
+    struct Slot
+    {
+        // one byte of putback area, then bufferSize bytes of data
+        std::vector<char>	storage;
+        size_t				size;
+        bool				full;
+        // set on the buffer that ends the input
+        bool				last;
+    };
+
+    int						fd;
+    size_t					bufferSize;
+    std::vector<Slot>		slots;
+    // slot the lexer is reading, or -1 before the first underflow
+    int						current;
+    std::mutex				lock;
+    std::condition_variable	changed;
+    bool					stopping;
+    // written to wake the reader up when the buffer is destroyed before the end of input
+    int						wakeup[2];
+    std::thread				reader;
+
+    AsyncInput(const AsyncInput&);
+    AsyncInput& operator=(const AsyncInput&);
+
+    void readAhead();
+    // fills a buffer, returns the number of bytes read; sets last at end of input or on error
+    size_t fill(char *data, bool& last);
+};
+
+#endif /* ASYNCINPUT_H_ */
@@ -0,0 +1,809 @@
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <sys/stat.h>
+
+#include "batch.h"
+#include "cache.h"
+
+const char COLUMN_FILE_MAGIC[8] = { 'P', 'C', 'O', 'L', 'U', 'M', 'N', '1' };
+
+// CSV as RFC 4180 has it: a header of names, then one record per row;
+// fields may be quoted, with "" for a quote, and lines may end in \r\n
+class CsvInput : public RowInput
+{
+    std::ifstream				in;
+    string						path;
+    std::vector<string>			names;
+    // the fields of the last record read, of which the first fieldCount are in use
+    std::vector<string>			fields;
+    size_t						fieldCount;
+    // the line the next record starts on
+    size_t						line;
+    string						message;
+
+    bool readRecord();
+    void fail(size_t recordLine, const string& what)
+    {
+        message = path + ":" + std::to_string(recordLine) + ": " + what;
+    }
+
+public:
+    CsvInput() : fieldCount(0), line(1) {}
+
+    bool open(const string& file)
+    {
+        path = file;
+        in.open(file);
+        if (in.fail())
+        {
+            return false;
+        }
+        if (readRecord())
+        {
+            names.assign(fields.begin(), fields.begin() + fieldCount);
+        }
+        return true;
+    }
+
+    virtual const std::vector<string>& getNames() const { return names; }
+    virtual const string& getError() const { return message; }
+    virtual bool read(size_t count, std::vector<RowColumn>& columns, size_t& rows);
+};
+
+bool CsvInput::readRecord()
+{
+    std::streambuf *buffer = in.rdbuf();
+    int c = buffer->sbumpc();
+    if (c == EOF)
+    {
+        return false;
+    }
+    fieldCount = 0;
+    // an empty line is a record without fields, for an input that binds nothing
+    if (c == '\n' || (c == '\r' && buffer->sgetc() == '\n'))
+    {
+        if (c == '\r')
+        {
+            buffer->sbumpc();
+        }
+        ++line;
+        return true;
+    }
+    for (;;)
+    {
+        if (fieldCount == fields.size())
+        {
+            fields.push_back(string());
+        }
+        string& field = fields[fieldCount++];
+        field.clear();
+        if (c == '"')
+        {
+            for (c = buffer->sbumpc(); c != EOF; c = buffer->sbumpc())
+            {
+                if (c == '"' && buffer->sgetc() != '"')
+                {
+                    c = buffer->sbumpc();
+                    break;
+                }
+                if (c == '"')
+                {
+                    buffer->sbumpc();
+                }
+                line += c == '\n' ? 1 : 0;
+                field += (char)c;
+            }
+        }
+        while (c != ',' && c != '\n' && c != '\r' && c != EOF)
+        {
+            field += (char)c;
+            c = buffer->sbumpc();
+        }
+        if (c == '\r' && buffer->sgetc() == '\n')
+        {
+            c = buffer->sbumpc();
+        }
+        if (c != ',')
+        {
+            break;
+        }
+        c = buffer->sbumpc();
+    }
+    ++line;
+    return true;
+}
+
+bool CsvInput::read(size_t count, std::vector<RowColumn>& columns, size_t& rows)
+{
+    for (RowColumn& column : columns)
+    {
+        column.ints.resize(count);
+        column.strings.resize(count);
+    }
+    for (rows = 0; rows < count; ++rows)
+    {
+        size_t recordLine = line;
+        if (!readRecord())
+        {
+            return true;
+        }
+        if (fieldCount != names.size())
+        {
+            fail(recordLine, "WRONG NUMBER OF FIELDS");
+            return false;
+        }
+        for (size_t i = 0; i < fieldCount; ++i)
+        {
+            const string& field = fields[i];
+            if (columns[i].type == STRING_TYPE)
+            {
+                columns[i].strings[rows] = Value::String(field);
+                continue;
+            }
+            const char *end = field.data() + field.size();
+            std::from_chars_result parsed = std::from_chars(field.data(), end, columns[i].ints[rows]);
+            if (field.empty() || parsed.ec != std::errc() || parsed.ptr != end)
+            {
+                fail(recordLine, "BAD INTEGER FOR " + names[i]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// A binary column file, mapped in whole, see batch.h
+class ColumnFileInput : public RowInput
+{
+    struct Column
+    {
+        TypeForNode	type;
+        size_t		offset;
+    };
+
+    MappedFile				file;
+    std::vector<string>		names;
+    std::vector<Column>		columns;
+    size_t					rowCount;
+    size_t					next;
+    string					path;
+    string					message;
+
+    // copies size bytes at offset to value, if it isn't null; false if the file is too short
+    bool fetch(size_t offset, void *value, size_t size) const
+    {
+        if (offset > file.getSize() || size > file.getSize() - offset)
+        {
+            return false;
+        }
+        if (value != 0)
+        {
+            memcpy(value, file.getData() + offset, size);
+        }
+        return true;
+    }
+
+public:
+    ColumnFileInput() : rowCount(0), next(0) {}
+
+    // Returns false with the error set if the file isn't a well-formed column file
+    bool open(const string& file);
+
+    virtual const std::vector<string>& getNames() const { return names; }
+    virtual const string& getError() const { return message; }
+    virtual bool read(size_t count, std::vector<RowColumn>& bound, size_t& rows);
+};
+
+bool ColumnFileInput::open(const string& filePath)
+{
+    path = filePath;
+    message = path + ": BAD COLUMN FILE";
+    uint32_t count;
+    uint64_t rows;
+    if (!file.open(path) || !fetch(8, &count, sizeof(count)) || !fetch(16, &rows, sizeof(rows)))
+    {
+        return false;
+    }
+    rowCount = rows;
+    size_t offset = 24;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t type, length;
+        uint64_t data;
+        if (!fetch(offset, &type, sizeof(type)) || !fetch(offset + 4, &length, sizeof(length)) ||
+            !fetch(offset + 8, &data, sizeof(data)) || type > 1 || !fetch(offset + 16, 0, length))
+        {
+            return false;
+        }
+        names.push_back(string(file.getData() + offset + 16, length));
+        Column column = { type == 0 ? INT_TYPE : STRING_TYPE, (size_t)data };
+        // the data must hold every row: the ints, or the offsets of the strings
+        size_t entry = type == 0 ? sizeof(int32_t) : sizeof(uint64_t);
+        if (rowCount > (file.getSize() - std::min(column.offset, file.getSize())) / entry)
+        {
+            return false;
+        }
+        columns.push_back(column);
+        offset += 16 + length;
+    }
+    message.clear();
+    return true;
+}
+
+bool ColumnFileInput::read(size_t count, std::vector<RowColumn>& bound, size_t& rows)
+{
+    rows = 0;
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        if (bound[i].type != columns[i].type)
+        {
+            message = path + ": " + names[i] + " IS NOT OF THE TYPE IT IS DECLARED WITH";
+            return false;
+        }
+    }
+    size_t available = std::min(count, rowCount - next);
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        const Column& column = columns[i];
+        if (column.type == INT_TYPE)
+        {
+            bound[i].ints.resize(available);
+            fetch(column.offset + next * sizeof(int32_t), bound[i].ints.data(), available * sizeof(int32_t));
+            continue;
+        }
+        bound[i].strings.resize(available);
+        // the characters start after the offsets
+        size_t characters = column.offset + (rowCount + 1) * sizeof(uint64_t);
+        for (size_t row = 0; row < available; ++row)
+        {
+            uint64_t begin, end;
+            if (!fetch(column.offset + (next + row) * sizeof(uint64_t), &begin, sizeof(begin)) ||
+                !fetch(column.offset + (next + row + 1) * sizeof(uint64_t), &end, sizeof(end)) ||
+                begin > end || !fetch(characters + begin, 0, end - begin))
+            {
+                message = path + ": BAD COLUMN FILE";
+                return false;
+            }
+            bound[i].strings[row] = Value::String(std::string_view(file.getData() + characters + begin, end - begin));
+        }
+    }
+    rows = available;
+    next += rows;
+    return true;
+}
+
+RowInput* openRowInput(const string& path, string& error)
+{
+    // a column file is mapped, so only a regular file can be one; a pipe is
+    // read as CSV without reading anything ahead
+    char magic[sizeof(COLUMN_FILE_MAGIC)] = {};
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+    {
+        std::ifstream probe(path, std::ios::binary);
+        probe.read(magic, sizeof(magic));
+    }
+    if (memcmp(magic, COLUMN_FILE_MAGIC, sizeof(magic)) == 0)
+    {
+        ColumnFileInput *columns = new ColumnFileInput;
+        if (!columns->open(path))
+        {
+            error = columns->getError();
+            delete columns;
+            return 0;
+        }
+        return columns;
+    }
+    CsvInput *csv = new CsvInput;
+    if (!csv->open(path))
+    {
+        error = path + " FILE NOT FOUND";
+        delete csv;
+        return 0;
+    }
+    return csv;
+}
+
+// Appends what is written to it to the output of one row
+class RowBuffer : public std::streambuf
+{
+    string	*row;
+
+protected:
+    virtual int_type overflow(int_type ch)
+    {
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+        {
+            row->push_back(traits_type::to_char_type(ch));
+        }
+        return traits_type::not_eof(ch);
+    }
+    virtual std::streamsize xsputn(const char *s, std::streamsize size)
+    {
+        row->append(s, size);
+        return size;
+    }
+
+public:
+    RowBuffer() : row(0) {}
+    void setRow(string *output) { row = output; }
+};
+
+// One instruction of an integer expression over columns
+// The operands are the top two of a stack of columns; the _REVERSED
+// operations have the right operand below the left one
+enum KernelCode { KERNEL_LOAD, KERNEL_CONSTANT, KERNEL_ADD, KERNEL_SUBTRACT, KERNEL_SUBTRACT_REVERSED,
+                  KERNEL_MULTIPLY, KERNEL_DIVIDE, KERNEL_DIVIDE_REVERSED };
+
+struct KernelOp
+{
+    KernelCode	code;
+    // the variable to load, or the constant
+    int			operand;
+};
+
+// A variable, a column of the batch
+struct Slot
+{
+    Atom				name;
+    TypeForNode			type;
+    // the input column bound to it, or -1
+    int					column;
+    std::vector<int>	ints;
+    std::vector<Value>	strings;
+    // its storage in the context rows are evaluated on one by one
+    Value				*value;
+};
+
+enum StepKind { STEP_DECLARE, STEP_SET, STEP_PRINT };
+
+struct BatchStep
+{
+    const ParseTree			*statement;
+    StepKind				kind;
+    // the variable declared or set
+    size_t					slot;
+    bool					newline;
+    // the expression over columns if it is an integer expression, else empty
+    std::vector<KernelOp>	kernel;
+    // the variables the statement mentions, for the rows evaluated one by one
+    std::vector<size_t>		slots;
+};
+
+// Collects the identifiers an expression reads
+class NameScan : public ParseTreeVisitor
+{
+public:
+    std::vector<Atom> names;
+
+    virtual bool beginVisit(const Identifier *id)
+    {
+        names.push_back(id->getAtom());
+        return false;
+    }
+};
+
+class BatchEvaluator
+{
+    std::vector<Slot>					slots;
+    std::unordered_map<Atom, size_t>	slotOf;
+    std::vector<BatchStep>				steps;
+    std::vector<RowColumn>				input;
+    // the stack of columns of the kernels
+    std::vector<int>					stack;
+    // rows a runtime error stopped, and rows a kernel leaves to Evaluate()
+    std::vector<unsigned char>			stopped;
+    std::vector<unsigned char>			scalar;
+    std::vector<string>					output;
+    RowBuffer							rowBuffer;
+    std::ostream						rowOutput;
+    Context								context;
+
+    int need(const ParseTree *expr, std::unordered_map<const ParseTree*, int>& needs) const;
+    bool compileKernel(const ParseTree *expr, std::vector<KernelOp>& code, size_t& depth, size_t height,
+                       std::unordered_map<const ParseTree*, int>& needs) const;
+    void runKernel(const std::vector<KernelOp>& code);
+    void declare(const BatchStep& step, size_t rows);
+    void evaluateRow(const BatchStep& step, size_t row);
+
+public:
+    BatchEvaluator() : rowOutput(&rowBuffer) {}
+
+    // Compiles the statements of program and binds the input columns to its variables
+    // Returns false with message set if a column names no declared variable
+    bool compile(const ParseTree *program, const std::vector<string>& names, string& message);
+    std::vector<RowColumn>& getInput() { return input; }
+    // Evaluates the program for the first rows of the input and writes their output
+    void run(size_t rows, ostream& out);
+};
+
+// Registers the stack needs to evaluate expr: the deeper operand goes first
+int BatchEvaluator::need(const ParseTree *expr, std::unordered_map<const ParseTree*, int>& needs) const
+{
+    if (expr->getLeft() == 0)
+    {
+        return 1;
+    }
+    std::unordered_map<const ParseTree*, int>::const_iterator it = needs.find(expr);
+    if (it != needs.end())
+    {
+        return it->second;
+    }
+    int left = need(expr->getLeft(), needs);
+    int right = need(expr->getRight(), needs);
+    int registers = left == right ? left + 1 : std::max(left, right);
+    needs[expr] = registers;
+    return registers;
+}
+
+// Appends the code of an integer expression; false if it isn't one
+// height is the stack in use below it, depth the most the code needs
+bool BatchEvaluator::compileKernel(const ParseTree *expr, std::vector<KernelOp>& code, size_t& depth, size_t height,
+                                   std::unordered_map<const ParseTree*, int>& needs) const
+{
+    depth = std::max(depth, height + 1);
+    if (const IntegerConstant *constant = dynamic_cast<const IntegerConstant*>(expr))
+    {
+        KernelOp op = { KERNEL_CONSTANT, constant->GetIntValue() };
+        code.push_back(op);
+        return true;
+    }
+    if (const Identifier *id = dynamic_cast<const Identifier*>(expr))
+    {
+        std::unordered_map<Atom, size_t>::const_iterator slot = slotOf.find(id->getAtom());
+        if (slot == slotOf.end() || slots[slot->second].type != INT_TYPE)
+        {
+            return false;
+        }
+        KernelOp op = { KERNEL_LOAD, (int)slot->second };
+        code.push_back(op);
+        return true;
+    }
+    KernelCode forward, reversed;
+    if (dynamic_cast<const Addition*>(expr) != 0)
+    {
+        forward = reversed = KERNEL_ADD;
+    }
+    else if (dynamic_cast<const Subtraction*>(expr) != 0)
+    {
+        forward = KERNEL_SUBTRACT;
+        reversed = KERNEL_SUBTRACT_REVERSED;
+    }
+    else if (dynamic_cast<const Multiplication*>(expr) != 0)
+    {
+        forward = reversed = KERNEL_MULTIPLY;
+    }
+    else if (dynamic_cast<const Division*>(expr) != 0)
+    {
+        forward = KERNEL_DIVIDE;
+        reversed = KERNEL_DIVIDE_REVERSED;
+    }
+    else
+    {
+        return false;
+    }
+    // the operand that needs more of the stack is evaluated first, so a long
+    // chain of operations needs two columns instead of one for every link
+    const ParseTree *first = expr->getLeft();
+    const ParseTree *second = expr->getRight();
+    bool swapped = need(second, needs) > need(first, needs);
+    if (swapped)
+    {
+        std::swap(first, second);
+    }
+    if (!compileKernel(first, code, depth, height, needs) || !compileKernel(second, code, depth, height + 1, needs))
+    {
+        return false;
+    }
+    KernelOp op = { swapped ? reversed : forward, 0 };
+    code.push_back(op);
+    return true;
+}
+
+// Applies operation to the top two columns of the stack for every row of a
+// batch, even past the rows in use: a loop of constant count over arrays that
+// don't overlap is what the compiler vectorizes at -O2
+// The operations wrap around in unsigned arithmetic, where overflowing ints
+// have always ended up
+template <class Operation>
+static void combineColumns(int *__restrict below, const int *__restrict top, Operation operation)
+{
+    for (size_t i = 0; i < BATCH_ROWS; ++i)
+    {
+        below[i] = (int)operation((unsigned)below[i], (unsigned)top[i]);
+    }
+}
+
+// Stores the result of a kernel in a variable, except in the rows that keep their value
+static void storeColumn(int *__restrict variable, const int *__restrict result,
+                        const unsigned char *__restrict stopped, const unsigned char *__restrict scalar)
+{
+    for (size_t i = 0; i < BATCH_ROWS; ++i)
+    {
+        variable[i] = stopped[i] | scalar[i] ? variable[i] : result[i];
+    }
+}
+
+void BatchEvaluator::runKernel(const std::vector<KernelOp>& code)
+{
+    size_t height = 0;
+    for (const KernelOp& op : code)
+    {
+        // the free column for a load, or the operands of an operation
+        int *next = stack.data() + height * BATCH_ROWS;
+        int *top = next - BATCH_ROWS;
+        int *below = top - BATCH_ROWS;
+        switch (op.code)
+        {
+            case KERNEL_LOAD:
+                memcpy(next, slots[op.operand].ints.data(), BATCH_ROWS * sizeof(int));
+                ++height;
+                break;
+            case KERNEL_CONSTANT:
+                std::fill(next, next + BATCH_ROWS, op.operand);
+                ++height;
+                break;
+            case KERNEL_ADD:
+                combineColumns(below, top, [](unsigned u, unsigned v) { return u + v; });
+                --height;
+                break;
+            case KERNEL_SUBTRACT:
+                combineColumns(below, top, [](unsigned u, unsigned v) { return u - v; });
+                --height;
+                break;
+            case KERNEL_SUBTRACT_REVERSED:
+                combineColumns(below, top, [](unsigned u, unsigned v) { return v - u; });
+                --height;
+                break;
+            case KERNEL_MULTIPLY:
+                combineColumns(below, top, [](unsigned u, unsigned v) { return u * v; });
+                --height;
+                break;
+            case KERNEL_DIVIDE:
+            case KERNEL_DIVIDE_REVERSED:
+                // a division by zero prints its error and stops the row, and
+                // INT_MIN / -1 traps: Evaluate() does both for those rows
+                for (size_t i = 0; i < BATCH_ROWS; ++i)
+                {
+                    int dividend = op.code == KERNEL_DIVIDE ? below[i] : top[i];
+                    int divisor = op.code == KERNEL_DIVIDE ? top[i] : below[i];
+                    bool unsafe = divisor == 0 || (divisor == -1 && dividend == INT_MIN);
+                    scalar[i] |= unsafe;
+                    below[i] = dividend / (unsafe ? 1 : divisor);
+                }
+                --height;
+                break;
+        }
+    }
+}
+
+bool BatchEvaluator::compile(const ParseTree *program, const std::vector<string>& names, string& message)
+{
+    context.inputFileName = theContext->inputFileName;
+    for (const ParseTree *list = program; list != 0; list = list->getRight())
+    {
+        const ParseTree *statement = list->getLeft();
+        if (const VariableDeclaration *declaration = dynamic_cast<const VariableDeclaration*>(statement))
+        {
+            Slot slot;
+            slot.name = declaration->getIdentifier()->getAtom();
+            slot.type = declaration->GetType();
+            slot.column = -1;
+            slot.value = 0;
+            slotOf[slot.name] = slots.size();
+            slots.push_back(slot);
+        }
+    }
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        std::unordered_map<Atom, size_t>::const_iterator slot = slotOf.find(theInterner->intern(names[i]));
+        if (slot == slotOf.end())
+        {
+            message = names[i] + " IS NOT DECLARED";
+            return false;
+        }
+        if (slots[slot->second].column >= 0)
+        {
+            message = names[i] + " IS BOUND TWICE";
+            return false;
+        }
+        slots[slot->second].column = i;
+        RowColumn column;
+        column.type = slots[slot->second].type;
+        input.push_back(column);
+    }
+    for (Slot& slot : slots)
+    {
+        slot.ints.resize(BATCH_ROWS);
+        slot.strings.resize(BATCH_ROWS);
+        slot.value = &context.variable(slot.name);
+    }
+
+    size_t depth = 0;
+    std::unordered_map<const ParseTree*, int> needs;
+    for (const ParseTree *list = program; list != 0; list = list->getRight())
+    {
+        BatchStep step;
+        step.statement = list->getLeft();
+        step.newline = false;
+        const ParseTree *expr = step.statement->getLeft();
+        NameScan scan;
+        if (const VariableDeclaration *declaration = dynamic_cast<const VariableDeclaration*>(step.statement))
+        {
+            step.kind = STEP_DECLARE;
+            step.slot = slotOf[declaration->getIdentifier()->getAtom()];
+        }
+        else if (const VariableAssignment *assignment = dynamic_cast<const VariableAssignment*>(step.statement))
+        {
+            step.kind = STEP_SET;
+            step.slot = slotOf[assignment->getIdentifier()->getAtom()];
+            scan.names.push_back(assignment->getIdentifier()->getAtom());
+        }
+        else
+        {
+            step.kind = STEP_PRINT;
+            step.slot = 0;
+            step.newline = ((const PrintCommand*)step.statement)->IsNewline();
+        }
+        if (expr != 0)
+        {
+            expr->accept(&scan);
+            if (!compileKernel(expr, step.kernel, depth, 0, needs))
+            {
+                step.kernel.clear();
+            }
+        }
+        for (Atom name : scan.names)
+        {
+            step.slots.push_back(slotOf[name]);
+        }
+        std::sort(step.slots.begin(), step.slots.end());
+        step.slots.erase(std::unique(step.slots.begin(), step.slots.end()), step.slots.end());
+        steps.push_back(step);
+    }
+    stack.resize(depth * BATCH_ROWS);
+    stopped.resize(BATCH_ROWS);
+    scalar.resize(BATCH_ROWS);
+    output.resize(BATCH_ROWS);
+    return true;
+}
+
+void BatchEvaluator::declare(const BatchStep& step, size_t rows)
+{
+    Slot& slot = slots[step.slot];
+    for (size_t row = 0; row < rows; ++row)
+    {
+        if (stopped[row])
+        {
+            continue;
+        }
+        if (slot.type == INT_TYPE)
+        {
+            slot.ints[row] = slot.column >= 0 ? input[slot.column].ints[row] : 0;
+            continue;
+        }
+        // every variable is declared once, so the bound value moves in
+        slot.strings[row] = slot.column >= 0 ? std::move(input[slot.column].strings[row]) : Value::String();
+    }
+}
+
+// Evaluates the statement of step for one row, with its variables moved into the context
+void BatchEvaluator::evaluateRow(const BatchStep& step, size_t row)
+{
+    rowBuffer.setRow(&output[row]);
+    for (size_t i : step.slots)
+    {
+        Slot& slot = slots[i];
+        if (slot.type == INT_TYPE)
+        {
+            *slot.value = Value::Integer(slot.ints[row]);
+        }
+        else
+        {
+            std::swap(*slot.value, slot.strings[row]);
+        }
+    }
+    if (step.statement->Evaluate().type != EMPTY_TYPE)
+    {
+        stopped[row] = 1;
+    }
+    for (size_t i : step.slots)
+    {
+        Slot& slot = slots[i];
+        if (slot.type == INT_TYPE)
+        {
+            slot.ints[row] = slot.value->intValue;
+        }
+        else
+        {
+            std::swap(*slot.value, slot.strings[row]);
+        }
+    }
+}
+
+void BatchEvaluator::run(size_t rows, ostream& out)
+{
+    Context *savedContext = theContext;
+    ostream *savedOutput = theOutput;
+    theContext = &context;
+    theOutput = &rowOutput;
+    std::fill(stopped.begin(), stopped.begin() + rows, 0);
+    for (const BatchStep& step : steps)
+    {
+        if (step.kind == STEP_DECLARE)
+        {
+            declare(step, rows);
+            continue;
+        }
+        bool kernel = !step.kernel.empty();
+        std::fill(scalar.begin(), scalar.end(), kernel ? 0 : 1);
+        if (kernel)
+        {
+            runKernel(step.kernel);
+        }
+        const int *result = stack.data();
+        if (kernel && step.kind == STEP_SET)
+        {
+            storeColumn(slots[step.slot].ints.data(), result, stopped.data(), scalar.data());
+        }
+        for (size_t row = 0; row < rows; ++row)
+        {
+            if (stopped[row])
+            {
+                continue;
+            }
+            if (scalar[row])
+            {
+                evaluateRow(step, row);
+            }
+            else if (step.kind == STEP_PRINT)
+            {
+                char digits[16];
+                std::to_chars_result printed = std::to_chars(digits, digits + sizeof(digits), result[row]);
+                output[row].append(digits, printed.ptr);
+                if (step.newline)
+                {
+                    output[row] += '\n';
+                }
+            }
+        }
+    }
+    theContext = savedContext;
+    theOutput = savedOutput;
+    for (size_t row = 0; row < rows; ++row)
+    {
+        out.write(output[row].data(), output[row].size());
+        output[row].clear();
+    }
+}
+
+bool evaluateRows(const ParseTree *program, RowInput& input, ostream& out)
+{
+    BatchEvaluator evaluator;
+    string message;
+    if (!evaluator.compile(program, input.getNames(), message))
+    {
+        out << message << std::endl;
+        return false;
+    }
+    for (;;)
+    {
+        size_t rows;
+        bool read = input.read(BATCH_ROWS, evaluator.getInput(), rows);
+        evaluator.run(rows, out);
+        if (!read)
+        {
+            out << input.getError() << std::endl;
+            return false;
+        }
+        if (rows == 0)
+        {
+            out.flush();
+            return true;
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <string>
+#include <vector>
+
+#include "parser.h"
+
+// Evaluation of one program over many rows of bindings
+//
+// The program is parsed and checked once. Every row of the input binds the
+// variables its columns name: the declaration of a bound variable gives it
+// the value of the row instead of 0 or "". Each row runs the whole program,
+// and the output of the rows is written in row order, so it is exactly what
+// running the program once per row, with the values spliced in, prints.
+//
+// Rows are evaluated BATCH_ROWS at a time, statement by statement, and every
+// variable is a column of the batch. A set or print of an integer
+// expression is compiled to a short stack program over whole columns, plain
+// loops over arrays of ints that the compiler vectorizes. Other statements,
+// and the rows where an integer division would divide by zero, go through
+// Evaluate() one row at a time on a context holding only the variables the
+// statement mentions. Nothing is set up per row.
+
+const size_t BATCH_ROWS = 1024;
+
+// Binary column file, in the byte order of the machine:
+//   "PCOLUMN1", uint32 column count, uint32 0, uint64 row count
+//   for every column: uint32 type (0 int, 1 string), uint32 length of its
+//   name, uint64 offset of its data in the file, the name
+//   the data of an int column: an int32 for every row
+//   the data of a string column: row count + 1 uint64 offsets of the strings
+//   from the end of the offsets, then their characters
+extern const char COLUMN_FILE_MAGIC[8];
+
+// The values of one bound variable for a batch of rows
+struct RowColumn
+{
+    TypeForNode			type;
+    std::vector<int>	ints;
+    std::vector<Value>	strings;
+};
+
+// Rows of bindings: a CSV file whose header names the variables, or a binary column file
+class RowInput
+{
+public:
+    virtual ~RowInput() {}
+
+    // the variables the columns bind, in order
+    virtual const std::vector<string>& getNames() const = 0;
+    // Reads up to count rows into columns, which have the types the program
+    // declares the variables with, and sets rows to the number read, 0 at the end
+    // Returns false if the input is malformed, see getError(); the rows
+    // before the malformed one are read
+    virtual bool read(size_t count, std::vector<RowColumn>& columns, size_t& rows) = 0;
+    virtual const string& getError() const = 0;
+};
+
+// Opens path as a binary column file if it starts with COLUMN_FILE_MAGIC and
+// as a CSV file if not; returns null and sets error if it can't be read
+extern RowInput* openRowInput(const string& path, string& error);
+
+// Evaluates a checked program for every row of input, writing the output to out
+// Returns false after printing why if the input doesn't fit the program;
+// the rows before that have run
+extern bool evaluateRows(const ParseTree *program, RowInput& input, ostream& out);
+
+#endif /* BATCH_H_ */
@@ -0,0 +1,474 @@
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+using namespace std;
+
+#include "parser.h"
+#include "semantic.h"
+#include "stats.h"
+#include "incremental.h"
+
+// Benchmarks of every phase on synthetic programs
+//
+// Every generator makes a program of a given size; the lexer alone, the parser
+// (which lexes as it goes), the semantic check and evaluation are timed on it
+// separately, each the best of several runs, and so is an edit of one byte in
+// the middle of the program reparsed and checked incrementally. For every generator the sizes
+// double, so the report shows how each phase scales: an exponent near 1 is
+// linear, near 2 quadratic. Results can be saved as a baseline and later runs
+// compared against it.
+
+// Program of a given size
+typedef string (*Generator)(int size);
+
+// size statements: declarations, sets and prints of small expressions
+static string statements(int size)
+{
+    ostringstream program;
+    program << "int a;\nint b;\nstring s;\nset a 1;\nset b 2;\nset s \"x\";\n";
+    for (int i = 0; i < size; ++i)
+    {
+        switch (i % 4)
+        {
+            case 0: program << "set a a + b * " << i % 7 + 1 << ";\n"; break;
+            case 1: program << "set b (a - " << i << ") / 3;\n"; break;
+            case 2: program << "set s s / \"y\" + \"y\";\n"; break;
+            default: program << "print a + b;\n"; break;
+        }
+    }
+    return program.str();
+}
+
+// one expression of size operators, chained the way Expr() and Term() nest them
+static string chain(int size)
+{
+    ostringstream program;
+    program << "int a;\nset a 1;\nprint a";
+    for (int i = 0; i < size; ++i)
+    {
+        program << (i % 3 == 0 ? " + " : i % 3 == 1 ? " - " : " * ") << "a";
+    }
+    program << ";\n";
+    return program.str();
+}
+
+// one expression nested in size parentheses
+static string parenthesized(int size)
+{
+    ostringstream program;
+    program << "int a;\nset a 1;\nprint " << string(size, '(') << "a";
+    for (int i = 0; i < size; ++i)
+    {
+        program << " + a)";
+    }
+    program << ";\n";
+    return program.str();
+}
+
+// size prints of a string constant of a kilobyte
+static string longStrings(int size)
+{
+    ostringstream program;
+    for (int i = 0; i < size; ++i)
+    {
+        program << "print \"" << string(1000, 'a' + i % 26) << "\";\n";
+    }
+    return program.str();
+}
+
+// size statements, each followed by a few lines of comments
+static string comments(int size)
+{
+    ostringstream program;
+    program << "int a;\n";
+    for (int i = 0; i < size; ++i)
+    {
+        program << "set a " << i << ";\n";
+        for (int line = 0; line < 4; ++line)
+        {
+            program << "// " << string(76, '-') << "\n";
+        }
+    }
+    return program.str();
+}
+
+// size variables, each declared, set and read
+static string identifiers(int size)
+{
+    ostringstream program;
+    for (int i = 0; i < size; ++i)
+    {
+        program << "int v" << i << ";\nset v" << i << " " << i << ";\n";
+    }
+    program << "print v0";
+    for (int i = 1; i < size; ++i)
+    {
+        program << " + v" << i;
+    }
+    program << ";\n";
+    return program.str();
+}
+
+// strings repeated size times, then shortened by removals
+static string repetitions(int size)
+{
+    ostringstream program;
+    program << "string s;\nset s " << size << " * \"abc\";\n";
+    for (int i = 0; i < 16; ++i)
+    {
+        program << "set s s / \"ca\" + " << size / 16 << " * \"b\";\n";
+    }
+    program << "print s / \"zzz\";\n";
+    return program.str();
+}
+
+struct Workload
+{
+    const char	*name;
+    Generator	generate;
+    // smallest size, and the number of doublings after it
+    int			size;
+    int			steps;
+};
+
+static const Workload workloads[] = {
+        { "statements", statements, 2000, 4 },
+        { "chain", chain, 250, 4 },
+        { "parenthesized", parenthesized, 250, 4 },
+        { "long-strings", longStrings, 250, 4 },
+        { "comments", comments, 2000, 4 },
+        { "identifiers", identifiers, 500, 4 },
+        { "repetitions", repetitions, 100000, 4 },
+};
+
+enum BenchPhase { BENCH_LEX, BENCH_PARSE, BENCH_CHECK, BENCH_EVALUATE, BENCH_EDIT, BENCH_PHASE_COUNT };
+static const char * const benchPhaseNames[BENCH_PHASE_COUNT] = { "lex", "parse", "check", "evaluate", "edit" };
+
+// Stream buffer that takes everything and keeps nothing, for the output of evaluation
+class DiscardBuffer : public streambuf
+{
+protected:
+    virtual int_type overflow(int_type ch) { return traits_type::not_eof(ch); }
+    virtual streamsize xsputn(const char *, streamsize size) { return size; }
+};
+
+// Starts a run of a program from scratch
+static void resetState(Context& context)
+{
+    context = Context();
+    theContext = &context;
+    lineNumber = 0;
+    hasParseErrors = false;
+    errorCount = 0;
+}
+
+struct Measurement
+{
+    long nanoseconds[BENCH_PHASE_COUNT];
+    long bytes;
+    long tokens;
+    long nodes;
+};
+
+static long elapsed(chrono::steady_clock::time_point start)
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+}
+
+// Best time of every phase over repeat runs
+// Returns false if the program doesn't parse and check, which is a bug of its generator
+static bool measure(const string& program, int repeat, Measurement& result)
+{
+    Context context;
+    Context *savedContext = theContext;
+    result.bytes = program.size();
+    for (int phase = 0; phase < BENCH_PHASE_COUNT; ++phase)
+    {
+        result.nanoseconds[phase] = -1;
+    }
+
+    for (int run = 0; run < repeat; ++run)
+    {
+        resetState(context);
+        istringstream in(program);
+        long tokens = 0;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        while (getToken(&in) != T_DONE)
+        {
+            ++tokens;
+        }
+        long time = elapsed(start);
+        result.tokens = tokens;
+        if (result.nanoseconds[BENCH_LEX] < 0 || time < result.nanoseconds[BENCH_LEX])
+        {
+            result.nanoseconds[BENCH_LEX] = time;
+        }
+    }
+
+    ParseTree *tree = 0;
+    for (int run = 0; run < repeat; ++run)
+    {
+        resetState(context);
+        istringstream in(program);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        ParseTree *parsed = Prog(&in);
+        long time = elapsed(start);
+        if (parsed == 0 || hasParseErrors)
+        {
+            theContext = savedContext;
+            return false;
+        }
+        if (result.nanoseconds[BENCH_PARSE] < 0 || time < result.nanoseconds[BENCH_PARSE])
+        {
+            result.nanoseconds[BENCH_PARSE] = time;
+        }
+        delete tree;
+        tree = parsed;
+    }
+
+    RunStats stats;
+    stats.countNodes(tree);
+    result.nodes = stats.totalNodes();
+
+    for (int run = 0; run < repeat; ++run)
+    {
+        resetState(context);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        bool checked = check(tree);
+        long time = elapsed(start);
+        if (!checked)
+        {
+            theContext = savedContext;
+            return false;
+        }
+        if (result.nanoseconds[BENCH_CHECK] < 0 || time < result.nanoseconds[BENCH_CHECK])
+        {
+            result.nanoseconds[BENCH_CHECK] = time;
+        }
+    }
+
+    DiscardBuffer discard;
+    ostream output(&discard);
+    ostream *savedOutput = theOutput;
+    theOutput = &output;
+    for (int run = 0; run < repeat; ++run)
+    {
+        resetState(context);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        tree->Evaluate();
+        long time = elapsed(start);
+        if (result.nanoseconds[BENCH_EVALUATE] < 0 || time < result.nanoseconds[BENCH_EVALUATE])
+        {
+            result.nanoseconds[BENCH_EVALUATE] = time;
+        }
+    }
+    theOutput = savedOutput;
+    delete tree;
+
+    // a newline after the semicolon in the middle, added and removed in turn
+    resetState(context);
+    IncrementalProgram incremental(program);
+    size_t semicolon = program.find(';', program.size() / 2);
+    size_t offset = semicolon != string::npos ? semicolon + 1 : program.size();
+    for (int run = 0; run < repeat; ++run)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if (run % 2 == 0)
+        {
+            incremental.edit(offset, 0, "\n");
+        }
+        else
+        {
+            incremental.edit(offset, 1, "");
+        }
+        long time = elapsed(start);
+        if (!incremental.isChecked())
+        {
+            theContext = savedContext;
+            return false;
+        }
+        if (result.nanoseconds[BENCH_EDIT] < 0 || time < result.nanoseconds[BENCH_EDIT])
+        {
+            result.nanoseconds[BENCH_EDIT] = time;
+        }
+    }
+    theContext = savedContext;
+    return true;
+}
+
+// Baseline entries are keyed by "workload size phase"
+typedef map<string, long> Baseline;
+
+static string baselineKey(const char *workload, int size, int phase)
+{
+    ostringstream key;
+    key << workload << " " << size << " " << benchPhaseNames[phase];
+    return key.str();
+}
+
+static bool readBaseline(const char *fileName, Baseline& baseline)
+{
+    ifstream in(fileName);
+    if (!in)
+    {
+        return false;
+    }
+    string workload, phase;
+    int size;
+    long nanoseconds;
+    while (in >> workload >> size >> phase >> nanoseconds)
+    {
+        baseline[workload + " " + to_string(size) + " " + phase] = nanoseconds;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int repeat = 5;
+    int steps = -1;
+    const char *filter = 0;
+    const char *saveFile = 0;
+    const char *compareFile = 0;
+    double tolerance = 10;
+    // --repeat n runs every phase n times and keeps the best time
+    // --steps n measures n+1 sizes per workload instead of the default
+    // --filter name runs only the workloads whose name contains name
+    // --save file writes the results to file, as a baseline
+    // --compare file compares the results with the baseline in file; phases slower by
+    // more than --tolerance percent (10 by default) are regressions, and make the exit status 1
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        string curArg = argv[arg];
+        if (curArg == "--repeat" && arg + 1 < argc)
+        {
+            repeat = atoi(argv[++arg]);
+        }
+        else if (curArg == "--steps" && arg + 1 < argc)
+        {
+            steps = atoi(argv[++arg]);
+        }
+        else if (curArg == "--filter" && arg + 1 < argc)
+        {
+            filter = argv[++arg];
+        }
+        else if (curArg == "--save" && arg + 1 < argc)
+        {
+            saveFile = argv[++arg];
+        }
+        else if (curArg == "--compare" && arg + 1 < argc)
+        {
+            compareFile = argv[++arg];
+        }
+        else if (curArg == "--tolerance" && arg + 1 < argc)
+        {
+            tolerance = atof(argv[++arg]);
+        }
+        else
+        {
+            cerr << "usage: parser-bench [--repeat n] [--steps n] [--filter name] [--save file] "
+                    "[--compare file [--tolerance percent]]" << endl;
+            return 2;
+        }
+    }
+
+    Baseline baseline;
+    if (compareFile != 0 && !readBaseline(compareFile, baseline))
+    {
+        cerr << compareFile << " FILE NOT FOUND" << endl;
+        return 2;
+    }
+    ofstream save;
+    if (saveFile != 0)
+    {
+        save.open(saveFile);
+    }
+
+    int regressions = 0;
+    cout << fixed;
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w)
+    {
+        const Workload& workload = workloads[w];
+        if (filter != 0 && string(workload.name).find(filter) == string::npos)
+        {
+            continue;
+        }
+        cout << workload.name << endl;
+        cout << setw(10) << "size" << setw(12) << "bytes" << setw(10) << "tokens" << setw(10) << "nodes"
+             << setw(14) << "lex MB/s" << setw(14) << "parse Mtok/s" << setw(14) << "check Mnode/s"
+             << setw(14) << "eval Mnode/s" << setw(12) << "edit us" << endl;
+
+        Measurement first, last;
+        int firstSize = 0, lastSize = 0;
+        int count = (steps >= 0 ? steps : workload.steps) + 1;
+        for (int step = 0; step < count; ++step)
+        {
+            int size = workload.size << step;
+            Measurement result;
+            if (!measure(workload.generate(size), repeat, result))
+            {
+                cerr << workload.name << " " << size << ": generated program doesn't check" << endl;
+                return 2;
+            }
+            cout << setprecision(1) << setw(10) << size << setw(12) << result.bytes << setw(10) << result.tokens
+                 << setw(10) << result.nodes
+                 << setw(14) << result.bytes * 1e3 / max(result.nanoseconds[BENCH_LEX], 1L)
+                 << setw(14) << result.tokens * 1e3 / max(result.nanoseconds[BENCH_PARSE], 1L)
+                 << setw(14) << result.nodes * 1e3 / max(result.nanoseconds[BENCH_CHECK], 1L)
+                 << setw(14) << result.nodes * 1e3 / max(result.nanoseconds[BENCH_EVALUATE], 1L)
+                 << setw(12) << result.nanoseconds[BENCH_EDIT] / 1e3 << endl;
+
+            for (int phase = 0; phase < BENCH_PHASE_COUNT; ++phase)
+            {
+                string key = baselineKey(workload.name, size, phase);
+                if (save.is_open())
+                {
+                    save << key << " " << result.nanoseconds[phase] << "\n";
+                }
+                Baseline::const_iterator it = baseline.find(key);
+                if (it != baseline.end() && it->second > 0)
+                {
+                    double change = 100.0 * (result.nanoseconds[phase] - it->second) / it->second;
+                    if (change > tolerance)
+                    {
+                        cout << "  REGRESSION " << key << ": " << setprecision(1) << change << "% slower than baseline" << endl;
+                        ++regressions;
+                    }
+                }
+            }
+            if (step == 0)
+            {
+                first = result;
+                firstSize = size;
+            }
+            last = result;
+            lastSize = size;
+        }
+
+        // time ~ size^exponent between the smallest and the largest size
+        if (lastSize > firstSize)
+        {
+            cout << "  scaling exponent:";
+            for (int phase = 0; phase < BENCH_PHASE_COUNT; ++phase)
+            {
+                double ratio = (double)max(last.nanoseconds[phase], 1L) / max(first.nanoseconds[phase], 1L);
+                cout << " " << benchPhaseNames[phase] << " " << setprecision(2)
+                     << log(ratio) / log((double)lastSize / firstSize);
+            }
+            cout << endl;
+        }
+    }
+    if (compareFile != 0)
+    {
+        cout << regressions << " regressions against " << compareFile << endl;
+    }
+    return regressions > 0 ? 1 : 0;
+}
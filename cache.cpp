@@ -0,0 +1,474 @@
+#include <cstring>
+#include <cstdio>
+#include <vector>
+using std::vector;
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache.h"
+
+// On-disk layout: CacheHeader, nodeCount CacheNode records, symbolCount
+// CacheSymbol records, poolSize bytes of string pool, then the sourceSize bytes
+// of the source.
+// All integers are in host byte order; the cache is not meant to be shared
+// between machines.
+struct CacheHeader
+{
+    char		magic[4];
+    uint32_t	version;
+    uint64_t	sourceHash;
+    uint32_t	statementCount;
+    uint32_t	nodeCount;
+    uint32_t	symbolCount;
+    uint32_t	poolSize;
+    uint64_t	sourceSize;
+};
+
+enum CacheNodeKind
+{
+    NODE_DECLARATION,	// flags: variable type, value: identifier line, offset/length: name
+    NODE_ASSIGNMENT,	// value: identifier line, offset/length: name, followed by the expression
+    NODE_PRINT,			// flags: 1 for println, followed by the expression
+    NODE_ADDITION,		// followed by left and right operands
+    NODE_SUBTRACTION,
+    NODE_MULTIPLICATION,
+    NODE_DIVISION,
+    NODE_INTEGER,		// value: the constant
+    NODE_STRING,		// offset/length: the constant
+    NODE_IDENTIFIER		// offset/length: name
+};
+
+struct CacheNode
+{
+    uint8_t		kind;
+    uint8_t		flags;
+    uint16_t	reserved;
+    int32_t		line;
+    int32_t		value;
+    uint32_t	offset;
+    uint32_t	length;
+};
+
+struct CacheSymbol
+{
+    uint32_t	offset;
+    uint32_t	length;
+    int32_t		type;
+};
+
+static const char cacheMagic[4] = { 'P', 'R', 'S', 'C' };
+
+uint64_t hashSource(const char *data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+MappedFile::~MappedFile()
+{
+    if (data != 0)
+    {
+        munmap((void*)data, size);
+    }
+}
+
+bool MappedFile::open(const string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+    void *mapped = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        return false;
+    }
+    data = (const char*)mapped;
+    size = st.st_size;
+    return true;
+}
+
+// Flattens the tree in preorder, which is also the order the loader consumes it
+class CacheWriter : public ParseTreeVisitor
+{
+    uint32_t addString(const string& s)
+    {
+        uint32_t offset = pool.size();
+        pool += s;
+        return offset;
+    }
+
+    void addNode(CacheNodeKind kind, const ParseTree *tree, int flags = 0, int value = 0, const string *text = 0)
+    {
+        CacheNode node;
+        memset(&node, 0, sizeof(node));
+        node.kind = kind;
+        node.flags = flags;
+        node.line = tree->getLineNumber();
+        node.value = value;
+        if (text != 0)
+        {
+            node.offset = addString(*text);
+            node.length = text->size();
+        }
+        nodes.push_back(node);
+    }
+
+public:
+    vector<CacheNode> nodes;
+    string pool;
+    uint32_t statementCount;
+
+    CacheWriter() : statementCount(0) {}
+
+    virtual bool beginVisit(const StatementList *)
+    {
+        ++statementCount;
+        return true;
+    }
+
+    virtual bool beginVisit(const VariableDeclaration *varDecl)
+    {
+        Identifier *identifier = varDecl->getIdentifier();
+        string name = identifier->getName();
+        addNode(NODE_DECLARATION, varDecl, varDecl->GetType(), identifier->getLineNumber(), &name);
+        return false;
+    }
+
+    virtual bool beginVisit(const VariableAssignment *varAssign)
+    {
+        Identifier *identifier = varAssign->getIdentifier();
+        string name = identifier->getName();
+        addNode(NODE_ASSIGNMENT, varAssign, 0, identifier->getLineNumber(), &name);
+        return true;
+    }
+
+    virtual bool beginVisit(const PrintCommand *printCmd)
+    {
+        addNode(NODE_PRINT, printCmd, printCmd->IsNewline() ? 1 : 0);
+        return true;
+    }
+
+    virtual bool beginVisit(const Addition *add)
+    {
+        addNode(NODE_ADDITION, add);
+        return true;
+    }
+
+    virtual bool beginVisit(const Subtraction *sub)
+    {
+        addNode(NODE_SUBTRACTION, sub);
+        return true;
+    }
+
+    virtual bool beginVisit(const Multiplication *mul)
+    {
+        addNode(NODE_MULTIPLICATION, mul);
+        return true;
+    }
+
+    virtual bool beginVisit(const Division *dvsn)
+    {
+        addNode(NODE_DIVISION, dvsn);
+        return true;
+    }
+
+    virtual bool beginVisit(const IntegerConstant *intConst)
+    {
+        addNode(NODE_INTEGER, intConst, 0, intConst->GetIntValue());
+        return false;
+    }
+
+    virtual bool beginVisit(const StringConstant *strConst)
+    {
+        string value = strConst->GetStringValue();
+        addNode(NODE_STRING, strConst, 0, 0, &value);
+        return false;
+    }
+
+    virtual bool beginVisit(const Identifier *identifier)
+    {
+        string name = identifier->getName();
+        addNode(NODE_IDENTIFIER, identifier, 0, 0, &name);
+        return false;
+    }
+};
+
+// Rebuilds the tree from the mapped records
+// Every offset is checked against the image, so a damaged entry is treated as a miss
+class CacheReader
+{
+    const CacheNode	*nodes;
+    uint32_t		nodeCount;
+    const char		*pool;
+    uint32_t		poolSize;
+    uint32_t		next;
+
+public:
+    CacheReader(const CacheNode *nodes, uint32_t nodeCount, const char *pool, uint32_t poolSize)
+            : nodes(nodes), nodeCount(nodeCount), pool(pool), poolSize(poolSize), next(0)
+    {
+    }
+
+    bool atEnd() const { return next == nodeCount; }
+
+    bool text(uint32_t offset, uint32_t length, string& out) const
+    {
+        if (offset > poolSize || length > poolSize - offset)
+        {
+            return false;
+        }
+        out.assign(pool + offset, length);
+        return true;
+    }
+
+    const CacheNode* take()
+    {
+        return next < nodeCount ? &nodes[next++] : 0;
+    }
+
+    ParseTree* readStatement()
+    {
+        const CacheNode *node = take();
+        if (node == 0)
+        {
+            return 0;
+        }
+        string name;
+        switch (node->kind)
+        {
+            case NODE_DECLARATION:
+                if (!text(node->offset, node->length, name) || (node->flags != INT_TYPE && node->flags != STRING_TYPE))
+                {
+                    return 0;
+                }
+                return new VariableDeclaration(node->line, (TypeForNode)node->flags, new Identifier(node->value, name));
+            case NODE_ASSIGNMENT:
+            {
+                if (!text(node->offset, node->length, name))
+                {
+                    return 0;
+                }
+                ParseTree *expr = readExpression();
+                return expr != 0 ? new VariableAssignment(node->line, new Identifier(node->value, name), expr) : 0;
+            }
+            case NODE_PRINT:
+            {
+                ParseTree *expr = readExpression();
+                return expr != 0 ? new PrintCommand(node->line, node->flags != 0, expr) : 0;
+            }
+        }
+        return 0;
+    }
+
+    ParseTree* readExpression()
+    {
+        const CacheNode *node = take();
+        if (node == 0)
+        {
+            return 0;
+        }
+        string value;
+        switch (node->kind)
+        {
+            case NODE_INTEGER:
+                return new IntegerConstant(node->line, node->value);
+            case NODE_STRING:
+                return text(node->offset, node->length, value) ? new StringConstant(node->line, value) : 0;
+            case NODE_IDENTIFIER:
+                return text(node->offset, node->length, value) ? new Identifier(node->line, value) : 0;
+            case NODE_ADDITION:
+            case NODE_SUBTRACTION:
+            case NODE_MULTIPLICATION:
+            case NODE_DIVISION:
+                break;
+            default:
+                return 0;
+        }
+        ParseTree *left = readExpression();
+        ParseTree *right = left != 0 ? readExpression() : 0;
+        if (right == 0)
+        {
+            delete left;
+            return 0;
+        }
+        switch (node->kind)
+        {
+            case NODE_ADDITION:
+                return new Addition(node->line, left, right);
+            case NODE_SUBTRACTION:
+                return new Subtraction(node->line, left, right);
+            case NODE_MULTIPLICATION:
+                return new Multiplication(node->line, left, right);
+            default:
+                return new Division(node->line, left, right);
+        }
+    }
+};
+
+string ProgramCache::entryPath(uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.pcc", (unsigned long long)key);
+    return directory + "/" + name;
+}
+
+ParseTree* ProgramCache::load(const string& source) const
+{
+    uint64_t key = hashSource(source.data(), source.size());
+    MappedFile file;
+    if (!file.open(entryPath(key)) || file.getSize() < sizeof(CacheHeader))
+    {
+        return 0;
+    }
+    const char *image = file.getData();
+    const CacheHeader *header = (const CacheHeader*)image;
+    if (memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) != 0 ||
+        header->version != CACHE_FORMAT_VERSION ||
+        header->sourceHash != key ||
+        header->sourceSize != source.size())
+    {
+        return 0;
+    }
+    uint64_t expectedSize = sizeof(CacheHeader) +
+                            (uint64_t)header->nodeCount * sizeof(CacheNode) +
+                            (uint64_t)header->symbolCount * sizeof(CacheSymbol) +
+                            header->poolSize + header->sourceSize;
+    if (expectedSize != file.getSize())
+    {
+        return 0;
+    }
+    const CacheNode *nodes = (const CacheNode*)(image + sizeof(CacheHeader));
+    const CacheSymbol *symbols = (const CacheSymbol*)(nodes + header->nodeCount);
+    const char *pool = (const char*)(symbols + header->symbolCount);
+    // the hash only picks the entry, the source decides whether it is this program's
+    if (memcmp(pool + header->poolSize, source.data(), source.size()) != 0)
+    {
+        return 0;
+    }
+
+    CacheReader reader(nodes, header->nodeCount, pool, header->poolSize);
+    vector<ParseTree*> statements;
+    statements.reserve(header->statementCount);
+    bool damaged = false;
+    for (uint32_t i = 0; i < header->statementCount && !damaged; ++i)
+    {
+        ParseTree *stmt = reader.readStatement();
+        damaged = stmt == 0;
+        if (!damaged)
+        {
+            statements.push_back(stmt);
+        }
+    }
+    damaged = damaged || !reader.atEnd();
+
+    map<Atom, TypeForNode> types;
+    for (uint32_t i = 0; i < header->symbolCount && !damaged; ++i)
+    {
+        string name;
+        damaged = !reader.text(symbols[i].offset, symbols[i].length, name);
+        if (!damaged)
+        {
+            types[theInterner->intern(name)] = (TypeForNode)symbols[i].type;
+        }
+    }
+    if (damaged)
+    {
+        for (ParseTree *stmt : statements)
+        {
+            delete stmt;
+        }
+        return 0;
+    }
+
+    // StmtList() nests the list to the right, with a null tail after the last statement
+    ParseTree *tree = 0;
+    for (size_t i = statements.size(); i-- > 0; )
+    {
+        tree = new StatementList(statements[i], tree);
+    }
+    theContext->typeTable.insert(types.begin(), types.end());
+    return tree;
+}
+
+bool ProgramCache::store(const string& source, const ParseTree *tree) const
+{
+    uint64_t key = hashSource(source.data(), source.size());
+    CacheWriter writer;
+    tree->accept(&writer);
+
+    vector<CacheSymbol> symbols;
+    for (TypeTable::const_iterator it = theContext->typeTable.begin(); it != theContext->typeTable.end(); ++it)
+    {
+        std::string_view name = theInterner->spelling(it->first);
+        CacheSymbol symbol;
+        symbol.offset = writer.pool.size();
+        symbol.length = name.size();
+        symbol.type = it->second;
+        writer.pool += name;
+        symbols.push_back(symbol);
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = CACHE_FORMAT_VERSION;
+    header.sourceHash = key;
+    header.statementCount = writer.statementCount;
+    header.nodeCount = writer.nodes.size();
+    header.symbolCount = symbols.size();
+    header.poolSize = writer.pool.size();
+    header.sourceSize = source.size();
+
+    mkdir(directory.c_str(), 0755);
+    string path = entryPath(key);
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".tmp%ld", (long)getpid());
+    string tempPath = path + suffix;
+
+    FILE *f = fopen(tempPath.c_str(), "wb");
+    if (f == 0)
+    {
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    if (ok && !writer.nodes.empty())
+    {
+        ok = fwrite(&writer.nodes[0], sizeof(CacheNode), writer.nodes.size(), f) == writer.nodes.size();
+    }
+    if (ok && !symbols.empty())
+    {
+        ok = fwrite(&symbols[0], sizeof(CacheSymbol), symbols.size(), f) == symbols.size();
+    }
+    if (ok && !writer.pool.empty())
+    {
+        ok = fwrite(writer.pool.data(), 1, writer.pool.size(), f) == writer.pool.size();
+    }
+    if (ok && !source.empty())
+    {
+        ok = fwrite(source.data(), 1, source.size(), f) == source.size();
+    }
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
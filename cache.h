@@ -0,0 +1,69 @@
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <string>
+using std::string;
+
+#include <stdint.h>
+
+#include "parser.h"
+
+// Persistent cache of checked programs
+//
+// A program that parsed and checked without any diagnostics is flattened into
+// a versioned binary image and stored under <dir>/<hash>.pcc, where <hash> is
+// the content hash of its source. The image holds a header, a preorder array of
+// fixed-size node records, the resolved variable table, and a string pool that
+// all names and string constants point into.
+// A later run with the same source maps the file with a single mmap and rebuilds
+// the tree straight from the records, skipping lexing, parsing and semantic check.
+// The image also holds the source itself, which a load compares with the program
+// it is asked for: FNV-1a collisions are easy to make, and must not run another program.
+
+// bump whenever the layout of the image or the meaning of a record changes
+const uint32_t CACHE_FORMAT_VERSION = 2;
+
+// 64-bit FNV-1a hash of the program text, used as the cache key
+extern uint64_t hashSource(const char *data, size_t size);
+
+// Read-only view of a whole file, mapped in with a single mmap
+class MappedFile
+{
+    const char	*data;
+    size_t		size;
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+public:
+    MappedFile() : data(0), size(0) {}
+    ~MappedFile();
+
+    // returns false if the file doesn't exist or can't be mapped
+    bool open(const string& path);
+
+    const char* getData() const { return data; }
+    size_t getSize() const { return size; }
+};
+
+class ProgramCache
+{
+    string directory;
+
+    string entryPath(uint64_t key) const;
+
+public:
+    ProgramCache(const string& directory) : directory(directory) {}
+
+    // Returns the program stored for source and restores its variable types in
+    // typeTable, or returns null if the entry is missing, was written by another
+    // format version, is damaged, or was stored for another source of the same hash
+    ParseTree* load(const string& source) const;
+
+    // Flattens a checked program and stores it for its source
+    // The entry is written to a temporary file and renamed into place,
+    // so concurrent readers never see a partial image
+    bool store(const string& source, const ParseTree *tree) const;
+};
+
+#endif /* CACHE_H_ */
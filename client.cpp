@@ -0,0 +1,130 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+#include "protocol.h"
+
+// parser-client: runs a program on parserd
+// Takes the same arguments as the parser itself, prints the same output
+// and exits with the same status
+
+int main(int argc, char *argv[])
+{
+    string socketPath = DEFAULT_SOCKET_PATH;
+    string *fileName = 0;
+    bool reportTime = false;
+    // -s path: socket parserd listens on
+    // --time: print round trip and server time on stderr
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        string curArg = argv[arg];
+        if (curArg == "-s" && arg + 1 < argc)
+        {
+            socketPath = argv[++arg];
+        }
+        else if (curArg == "--time")
+        {
+            reportTime = true;
+        }
+        else if (fileName == 0)
+        {
+            fileName = new string(curArg);
+        }
+        else
+        {
+            cout << "TOO MANY FILES" << endl;
+            return 1;
+        }
+    }
+
+    stringstream source;
+    if (fileName == 0)
+    {
+        source << cin.rdbuf();
+    }
+    else
+    {
+        ifstream f(fileName->c_str());
+        if (f.fail())
+        {
+            cout << *fileName << " FILE NOT FOUND" << endl;
+            return 1;
+        }
+        source << f.rdbuf();
+    }
+    string text = source.str();
+    string name = fileName != 0 ? *fileName : "";
+    // parserd refuses them before reading all of them
+    if (name.size() > MAX_NAME_LENGTH || text.size() > MAX_SOURCE_BYTES)
+    {
+        cout << (name.size() > MAX_NAME_LENGTH ? "FILE NAME TOO LONG" : "PROGRAM TOO LARGE") << endl;
+        return 1;
+    }
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr*)&address, sizeof(address)) != 0)
+    {
+        cerr << socketPath << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    uint32_t nameLength = name.size();
+    if (!writeFully(fd, &nameLength, sizeof(nameLength)) ||
+        !writeFully(fd, name.data(), name.size()) ||
+        !writeFully(fd, text.data(), text.size()))
+    {
+        cerr << socketPath << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    shutdown(fd, SHUT_WR);
+
+    vector<char> payload;
+    FrameHeader header;
+    while (readFully(fd, &header, sizeof(header)))
+    {
+        payload.resize(header.length);
+        if (header.length > 0 && !readFully(fd, &payload[0], header.length))
+        {
+            break;
+        }
+        if (header.type == FRAME_OUTPUT)
+        {
+            cout.write(&payload[0], payload.size());
+        }
+        else if (header.type == FRAME_ERROR)
+        {
+            cout.flush();
+            cerr << socketPath << ": ";
+            cerr.write(&payload[0], payload.size());
+            cerr << endl;
+        }
+        else if (header.type == FRAME_STATUS && header.length == sizeof(StatusFrame))
+        {
+            StatusFrame status;
+            memcpy(&status, &payload[0], sizeof(status));
+            cout.flush();
+            if (reportTime)
+            {
+                chrono::microseconds elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+                cerr << "round trip " << elapsed.count() << " us, server " << status.serviceMicros << " us" << endl;
+            }
+            return status.exitStatus;
+        }
+    }
+    cerr << socketPath << ": connection closed without a status" << endl;
+    return 1;
+}
@@ -0,0 +1,136 @@
+#include <set>
+#include <vector>
+using std::set;
+using std::vector;
+
+#include "deadstore.h"
+
+// Collects the names an expression reads, counts its nodes, finds integer
+// divisions that may divide by zero and string operations that may exceed a limit
+class ExpressionScan : public ParseTreeVisitor
+{
+protected:
+    virtual bool beginVisitNode(const ParseTree *)
+    {
+        ++nodes;
+        return true;
+    }
+
+public:
+    set<Atom> uses;
+    int nodes;
+    bool mayDivideByZero;
+    // a string + or *, which the governor may stop
+    bool buildsString;
+
+    ExpressionScan() : nodes(0), mayDivideByZero(false), buildsString(false) {}
+
+    virtual bool beginVisit(const Identifier *identifier)
+    {
+        ++nodes;
+        uses.insert(identifier->getAtom());
+        return false;
+    }
+
+    virtual bool beginVisit(const Division *dvsn)
+    {
+        ++nodes;
+        const ParseTree *divisor = dvsn->getRight();
+        bool safe = dvsn->GetCheckedType() != INT_TYPE ||
+                    (dynamic_cast<const IntegerConstant*>(divisor) != 0 && divisor->GetIntValue() != 0);
+        if (!safe)
+        {
+            mayDivideByZero = true;
+        }
+        return true;
+    }
+
+    virtual bool beginVisit(const Addition *add)
+    {
+        return beginVisitStringOperation(add);
+    }
+
+    virtual bool beginVisit(const Multiplication *mul)
+    {
+        return beginVisitStringOperation(mul);
+    }
+
+    bool beginVisitStringOperation(const ParseTree *op)
+    {
+        ++nodes;
+        if (op->GetCheckedType() == STRING_TYPE)
+        {
+            buildsString = true;
+        }
+        return true;
+    }
+};
+
+ParseTree* eliminateDeadStores(ParseTree *program, DeadStoreReport& report, const ResourceLimits& limits)
+{
+    vector<ParseTree*> statements;
+    for (ParseTree *list = program; list != 0; list = list->getRight())
+    {
+        statements.push_back(list->getLeft());
+    }
+
+    // Backward pass: live holds the names whose current value may still be read
+    vector<bool> keep(statements.size(), true);
+    set<Atom> live;
+    set<Atom> referenced;
+    for (size_t i = statements.size(); i-- > 0; )
+    {
+        ParseTree *stmt = statements[i];
+        if (VariableDeclaration *varDecl = dynamic_cast<VariableDeclaration*>(stmt))
+        {
+            // decided in the second pass, once all removed sets are known
+            live.erase(varDecl->getIdentifier()->getAtom());
+            continue;
+        }
+
+        ExpressionScan scan;
+        stmt->getLeft()->accept(&scan);
+        if (VariableAssignment *varAssign = dynamic_cast<VariableAssignment*>(stmt))
+        {
+            Atom name = varAssign->getIdentifier()->getAtom();
+            TypeForNode type = stmt->getLeft()->GetCheckedType();
+            bool observable = scan.mayDivideByZero || type == ERROR_TYPE ||
+                              limits.timeLimit.count() != 0 ||
+                              (limits.maxStringBytes != 0 && type == STRING_TYPE) ||
+                              (limits.maxValueBytes != 0 && scan.buildsString);
+            if (live.find(name) == live.end() && !observable)
+            {
+                keep[i] = false;
+                ++report.removedAssignments;
+                report.nodesSaved += scan.nodes;
+                continue;
+            }
+            live.erase(name);
+            referenced.insert(name);
+        }
+        live.insert(scan.uses.begin(), scan.uses.end());
+        referenced.insert(scan.uses.begin(), scan.uses.end());
+    }
+
+    // A declaration is only needed if some remaining statement names the variable
+    for (size_t i = 0; i < statements.size(); ++i)
+    {
+        VariableDeclaration *varDecl = dynamic_cast<VariableDeclaration*>(statements[i]);
+        if (varDecl != 0 && referenced.find(varDecl->getIdentifier()->getAtom()) == referenced.end())
+        {
+            keep[i] = false;
+            ++report.removedDeclarations;
+        }
+    }
+
+    // StmtList() nests the list to the right, with a null tail after the last statement
+    ParseTree *result = 0;
+    for (size_t i = statements.size(); i-- > 0; )
+    {
+        if (keep[i])
+        {
+            result = new StatementList(statements[i], result);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,35 @@
+#ifndef DEADSTORE_H_
+#define DEADSTORE_H_
+
+#include "parser.h"
+
+// Dead-store and unused-declaration elimination
+//
+// A backward liveness pass over the statement list of a checked program removes
+// every set whose value is overwritten or never read before the program ends,
+// and then every declaration of a name no remaining statement refers to.
+// A set is kept, whether live or not, if evaluating it could be observed:
+// an integer division whose divisor isn't a nonzero constant may print
+// DIVIDE BY ZERO, and an operation with a type error stops the program.
+// Under resource limits (governor.h) more sets can be observed: with a time
+// limit every set checks the time, with a limit on string memory every string
+// a set leaves in a variable counts against it, and with a limit on the size of
+// values a string + or * may fail, so those sets are kept as well.
+
+struct DeadStoreReport
+{
+    int removedAssignments;
+    int removedDeclarations;
+    // expression nodes that are no longer evaluated
+    int nodesSaved;
+
+    DeadStoreReport() : removedAssignments(0), removedDeclarations(0), nodesSaved(0) {}
+};
+
+// Returns the program without the dead statements, or null if none is left
+// typeTable must hold the types of the checked program, and limits are those
+// the program will be evaluated under
+extern ParseTree* eliminateDeadStores(ParseTree *program, DeadStoreReport& report,
+                                      const ResourceLimits& limits = ResourceLimits());
+
+#endif /* DEADSTORE_H_ */
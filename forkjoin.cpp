@@ -0,0 +1,97 @@
+#include <sstream>
+
+#include "forkjoin.h"
+
+// Estimated cost of evaluating tree, marking fork points on the way
+// Every node counts one; repeating a string k times also costs k,
+// since that is where large intermediate values come from
+static unsigned long markCost(ParseTree *tree, unsigned long threshold, int& marked)
+{
+    if (tree == 0)
+    {
+        return 0;
+    }
+    unsigned long left = markCost(tree->getLeft(), threshold, marked);
+    unsigned long right = markCost(tree->getRight(), threshold, marked);
+    unsigned long cost = 1 + left + right;
+
+    bool binary = dynamic_cast<Addition*>(tree) != 0 || dynamic_cast<Subtraction*>(tree) != 0 ||
+                  dynamic_cast<Multiplication*>(tree) != 0 || dynamic_cast<Division*>(tree) != 0;
+    if (!binary)
+    {
+        return cost;
+    }
+    if (dynamic_cast<Multiplication*>(tree) != 0 && tree->GetCheckedType() == STRING_TYPE)
+    {
+        const ParseTree *count = dynamic_cast<IntegerConstant*>(tree->getRight());
+        if (count == 0)
+        {
+            count = dynamic_cast<IntegerConstant*>(tree->getLeft());
+        }
+        if (count != 0 && count->GetIntValue() > 0)
+        {
+            cost += count->GetIntValue();
+        }
+    }
+    bool fork = left >= threshold && right >= threshold;
+    tree->setForkOperands(fork);
+    if (fork)
+    {
+        ++marked;
+    }
+    return cost;
+}
+
+int markForkPoints(ParseTree *program, unsigned long threshold)
+{
+    int marked = 0;
+    for (ParseTree *list = program; list != 0; list = list->getRight())
+    {
+        markCost(list->getLeft(), threshold, marked);
+    }
+    return marked;
+}
+
+void ForkJoinEvaluator::evaluate(const ParseTree *op, Value& left, Value& right)
+{
+    if (!op->getForkOperands())
+    {
+        right = op->getRight()->EvaluateExpr();
+        left = op->getLeft()->EvaluateExpr();
+        return;
+    }
+
+    Context *context = theContext;
+    const LineTable *lines = theLineTable;
+    ResourceGovernor *governor = theGovernor;
+    std::ostringstream leftOutput;
+    WorkStealingPool::Task task([this, op, context, lines, governor, &left, &leftOutput]()
+    {
+        // the task may run nested inside another task on this thread
+        Context *savedContext = theContext;
+        ostream *savedOutput = theOutput;
+        OperandEvaluator *savedEvaluator = theOperandEvaluator;
+        ResourceGovernor *savedGovernor = theGovernor;
+        LineScope scope(lines);
+        theContext = context;
+        theOutput = &leftOutput;
+        theOperandEvaluator = this;
+        theGovernor = governor;
+        {
+            // the operand is computed on the scratch of this thread and copied out
+            // for the thread that forked it
+            ScratchScope scratch;
+            Value operand = op->getLeft()->EvaluateExpr();
+            LongLivedScope copied;
+            left = operand;
+        }
+        theContext = savedContext;
+        theOutput = savedOutput;
+        theOperandEvaluator = savedEvaluator;
+        theGovernor = savedGovernor;
+    });
+    pool.fork(task);
+    right = op->getRight()->EvaluateExpr();
+    pool.join(task);
+    *theOutput << leftOutput.str();
+}
@@ -0,0 +1,33 @@
+#ifndef FORKJOIN_H_
+#define FORKJOIN_H_
+
+#include "parser.h"
+#include "workstealing.h"
+
+// Fork-join evaluation of large expressions
+//
+// markForkPoints() estimates the cost of every subexpression and marks the
+// operations whose operands both cost at least threshold. While a
+// ForkJoinEvaluator is installed as theOperandEvaluator, a marked operation
+// forks its left operand onto the pool and evaluates the right operand itself,
+// then joins. The forked operand prints into a buffer that is written after
+// the right operand's output, so DIVIDE BY ZERO and other messages come out
+// in the order sequential evaluation prints them.
+
+// operand cost below which forking costs more than it saves
+const unsigned long DEFAULT_FORK_THRESHOLD = 2000;
+
+// Marks the fork points of every statement in program, returns how many were marked
+extern int markForkPoints(ParseTree *program, unsigned long threshold = DEFAULT_FORK_THRESHOLD);
+
+class ForkJoinEvaluator : public OperandEvaluator
+{
+    WorkStealingPool&	pool;
+
+public:
+    explicit ForkJoinEvaluator(WorkStealingPool& pool) : pool(pool) {}
+
+    virtual void evaluate(const ParseTree *op, Value& left, Value& right);
+};
+
+#endif /* FORKJOIN_H_ */
@@ -0,0 +1,71 @@
+#include "governor.h"
+
+const char * const VALUE_TOO_LARGE = "VALUE TOO LARGE";
+const char * const OUT_OF_STRING_MEMORY = "OUT OF STRING MEMORY";
+const char * const TIME_LIMIT_EXCEEDED = "TIME LIMIT EXCEEDED";
+
+thread_local ResourceGovernor *theGovernor = 0;
+
+ResourceGovernor::ResourceGovernor(const ResourceLimits& limits)
+        : limits(limits),
+          deadline(std::chrono::steady_clock::now() + limits.timeLimit),
+          left(0),
+          ticking(true),
+          variableBytes(0)
+{
+}
+
+const char* ResourceGovernor::admit(size_t bytes, size_t operandBytes) const
+{
+    if (limits.maxValueBytes != 0 && bytes > limits.maxValueBytes)
+    {
+        return VALUE_TOO_LARGE;
+    }
+    // compared piece by piece, so sizes near the top of size_t don't wrap around
+    if (limits.maxStringBytes != 0)
+    {
+        size_t available = limits.maxStringBytes;
+        size_t held[] = { variableBytes.load(std::memory_order_relaxed), operandBytes, bytes };
+        for (size_t size : held)
+        {
+            if (size > available)
+            {
+                return OUT_OF_STRING_MEMORY;
+            }
+            available -= size;
+        }
+    }
+    return checkTime();
+}
+
+const char* ResourceGovernor::checkTime() const
+{
+    if (limits.timeLimit.count() != 0 && (ticking ? std::chrono::steady_clock::now() > deadline : left.count() < 0))
+    {
+        return TIME_LIMIT_EXCEEDED;
+    }
+    return 0;
+}
+
+void ResourceGovernor::stopClock()
+{
+    if (ticking)
+    {
+        left = deadline - std::chrono::steady_clock::now();
+        ticking = false;
+    }
+}
+
+void ResourceGovernor::startClock()
+{
+    if (!ticking)
+    {
+        deadline = std::chrono::steady_clock::now() + left;
+        ticking = true;
+    }
+}
+
+void ResourceGovernor::assign(size_t oldBytes, size_t newBytes)
+{
+    variableBytes.fetch_add(newBytes - oldBytes, std::memory_order_relaxed);
+}
@@ -0,0 +1,74 @@
+#ifndef GOVERNOR_H_
+#define GOVERNOR_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+// Resource limits of the evaluation of one program
+//
+// + and * know the size of a string result before they build it, so they ask
+// the governor first and fail with a runtime error on their line instead of
+// allocating past a limit:
+//  - no single value may be longer than maxValueBytes
+//  - the strings held by variables, plus the operands and the result of the
+//    operation, may not take more than maxStringBytes
+//  - evaluation may not take longer than timeLimit, which is also checked at
+//    every set and print; the clock can be stopped while something else runs,
+//    such as parsing the program after its prelude ran
+// A limit of 0 is no limit.
+
+struct ResourceLimits
+{
+    size_t						maxValueBytes;
+    size_t						maxStringBytes;
+    std::chrono::milliseconds	timeLimit;
+
+    ResourceLimits() : maxValueBytes(0), maxStringBytes(0), timeLimit(0) {}
+
+    bool any() const { return maxValueBytes != 0 || maxStringBytes != 0 || timeLimit.count() != 0; }
+};
+
+extern const char * const VALUE_TOO_LARGE;
+extern const char * const OUT_OF_STRING_MEMORY;
+extern const char * const TIME_LIMIT_EXCEEDED;
+
+class ResourceGovernor
+{
+    ResourceLimits							limits;
+    std::chrono::steady_clock::time_point	deadline;
+    // the evaluation time left while the clock is stopped
+    std::chrono::steady_clock::duration		left;
+    bool									ticking;
+    // bytes of the strings variables hold; statements on -j threads update it at once
+    std::atomic<size_t>						variableBytes;
+
+    ResourceGovernor(const ResourceGovernor&);
+    ResourceGovernor& operator=(const ResourceGovernor&);
+
+public:
+    // The time limit counts from here
+    explicit ResourceGovernor(const ResourceLimits& limits);
+
+    // Message of the limit a new string of bytes would exceed while operands
+    // of operandBytes are alive, or null if it may be built
+    const char* admit(size_t bytes, size_t operandBytes) const;
+    // TIME_LIMIT_EXCEEDED once the time is up, null until then
+    const char* checkTime() const;
+
+    // Stop the clock and start it again with the time that was left, around
+    // what isn't evaluation; not while a program is evaluated under the governor
+    void stopClock();
+    void startClock();
+
+    // A variable holding a string of oldBytes is set to one of newBytes
+    void assign(size_t oldBytes, size_t newBytes);
+
+    const ResourceLimits& getLimits() const { return limits; }
+};
+
+// The governor of the evaluation on this thread, or null if it has no limits
+// The threads of -j evaluate under the governor of the thread that started them
+extern thread_local ResourceGovernor *theGovernor;
+
+#endif /* GOVERNOR_H_ */
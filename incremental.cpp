@@ -0,0 +1,814 @@
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+#include "incremental.h"
+#include "semantic.h"
+#include "share.h"
+#include "stats.h"
+
+// Collects the nodes of a statement, to move their lines
+class StatementNodes : public NodeKindVisitor
+{
+protected:
+    virtual void visitNode(const ParseTree *node, NodeKind kind) { nodes.push_back(std::make_pair(node, kind)); }
+
+public:
+    std::vector<std::pair<const ParseTree*, NodeKind> > nodes;
+};
+
+void GapBuffer::replace(size_t offset, size_t removed, const string& inserted)
+{
+    // move the gap to offset
+    if (offset < gapBegin)
+    {
+        size_t moved = gapBegin - offset;
+        text.replace(gapEnd - moved, moved, text, offset, moved);
+        gapBegin -= moved;
+        gapEnd -= moved;
+    }
+    else if (offset > gapBegin)
+    {
+        size_t moved = offset - gapBegin;
+        text.replace(gapBegin, moved, text, gapEnd, moved);
+        gapBegin += moved;
+        gapEnd += moved;
+    }
+    gapEnd += removed;
+    if (inserted.size() > gapEnd - gapBegin)
+    {
+        // a gap as large as the text, so growing costs a constant per byte inserted
+        size_t gap = inserted.size() + std::max(size(), (size_t)1024);
+        text.insert(gapEnd, gap - (gapEnd - gapBegin), '\0');
+        gapEnd = gapBegin + gap;
+    }
+    text.replace(gapBegin, inserted.size(), inserted);
+    gapBegin += inserted.size();
+}
+
+string GapBuffer::str() const
+{
+    string whole(text, 0, gapBegin);
+    whole.append(text, gapEnd, string::npos);
+    return whole;
+}
+
+IncrementalProgram::IncrementalProgram()
+        : sourceValid(false),
+          statements(0),
+          uncheckedStatements(0),
+          parsedStatements(0),
+          list(0),
+          listBuilt(false)
+{
+    std::vector<Token> tokens;
+    Statement *tail = lex(0, 0, tokens);
+    parse(tail, tokens, 0, 0);
+    update(tail);
+    statements = tail;
+    count(tail, 1);
+    report.relexed = 1;
+    report.rechecked = 0;
+    report.statements = 1;
+}
+
+IncrementalProgram::IncrementalProgram(const string& source)
+        : IncrementalProgram()
+{
+    edit(0, 0, source);
+}
+
+IncrementalProgram::~IncrementalProgram()
+{
+    freeList();
+    deleteStatements(statements);
+}
+
+const string& IncrementalProgram::getSource() const
+{
+    if (!sourceValid)
+    {
+        source = text.str();
+        sourceValid = true;
+    }
+    return source;
+}
+
+void IncrementalProgram::deleteStatements(Statement *tree)
+{
+    if (tree != 0)
+    {
+        deleteStatements(tree->left);
+        deleteStatements(tree->right);
+        delete tree->tree;
+        delete tree;
+    }
+}
+
+void IncrementalProgram::update(Statement *node)
+{
+    size_t before = node->left != 0 ? node->left->totalBytes : 0;
+    node->count = 1;
+    node->totalBytes = node->bytes;
+    node->totalLines = node->lines;
+    node->failures = node->parseFailed ? 1 : 0;
+    node->reach = node->parseFailed ? before + node->bytes + node->lookahead : 0;
+    if (node->left != 0 && node->left->reach != 0)
+    {
+        node->reach = std::max(node->reach, node->left->reach);
+    }
+    if (node->right != 0 && node->right->reach != 0)
+    {
+        node->reach = std::max(node->reach, before + node->bytes + node->right->reach);
+    }
+    for (Statement *child : { node->left, node->right })
+    {
+        if (child != 0)
+        {
+            node->count += child->count;
+            node->totalBytes += child->totalBytes;
+            node->totalLines += child->totalLines;
+            node->failures += child->failures;
+            child->parent = node;
+        }
+    }
+}
+
+IncrementalProgram::Statement* IncrementalProgram::merge(Statement *left, Statement *right)
+{
+    if (left == 0 || right == 0)
+    {
+        return left != 0 ? left : right;
+    }
+    if (left->priority > right->priority)
+    {
+        left->right = merge(left->right, right);
+        update(left);
+        return left;
+    }
+    right->left = merge(left, right->left);
+    update(right);
+    return right;
+}
+
+void IncrementalProgram::split(Statement *tree, size_t count, Statement *&left, Statement *&right)
+{
+    if (tree == 0)
+    {
+        left = 0;
+        right = 0;
+        return;
+    }
+    size_t before = tree->left != 0 ? tree->left->count : 0;
+    if (count <= before)
+    {
+        split(tree->left, count, left, tree->left);
+        right = tree;
+    }
+    else
+    {
+        split(tree->right, count - before - 1, tree->right, right);
+        left = tree;
+    }
+    update(tree);
+    tree->parent = 0;
+}
+
+IncrementalProgram::Position IncrementalProgram::position(const Statement *stmt)
+{
+    Position at = { 0, 0, 0 };
+    if (stmt->left != 0)
+    {
+        at.index = stmt->left->count;
+        at.begin = stmt->left->totalBytes;
+        at.line = stmt->left->totalLines;
+    }
+    for (const Statement *node = stmt; node->parent != 0; node = node->parent)
+    {
+        const Statement *up = node->parent;
+        if (node == up->right)
+        {
+            at.index += 1;
+            at.begin += up->bytes;
+            at.line += up->lines;
+            if (up->left != 0)
+            {
+                at.index += up->left->count;
+                at.begin += up->left->totalBytes;
+                at.line += up->left->totalLines;
+            }
+        }
+    }
+    return at;
+}
+
+IncrementalProgram::Statement* IncrementalProgram::next(Statement *stmt)
+{
+    if (stmt->right != 0)
+    {
+        stmt = stmt->right;
+        while (stmt->left != 0)
+        {
+            stmt = stmt->left;
+        }
+        return stmt;
+    }
+    while (stmt->parent != 0 && stmt == stmt->parent->right)
+    {
+        stmt = stmt->parent;
+    }
+    return stmt->parent;
+}
+
+IncrementalProgram::Statement* IncrementalProgram::firstStatement() const
+{
+    Statement *stmt = statements;
+    while (stmt->left != 0)
+    {
+        stmt = stmt->left;
+    }
+    return stmt;
+}
+
+IncrementalProgram::Statement* IncrementalProgram::firstFailed() const
+{
+    if (statements->failures == 0)
+    {
+        return 0;
+    }
+    Statement *stmt = statements;
+    for (;;)
+    {
+        if (stmt->left != 0 && stmt->left->failures != 0)
+        {
+            stmt = stmt->left;
+        }
+        else if (stmt->parseFailed)
+        {
+            return stmt;
+        }
+        else
+        {
+            stmt = stmt->right;
+        }
+    }
+}
+
+IncrementalProgram::Statement* IncrementalProgram::failedReaching(size_t offset) const
+{
+    if (statements->reach <= offset)
+    {
+        return 0;
+    }
+    // the bytes before the subtree of stmt
+    size_t base = 0;
+    Statement *stmt = statements;
+    for (;;)
+    {
+        size_t before = stmt->left != 0 ? stmt->left->totalBytes : 0;
+        if (stmt->left != 0 && stmt->left->reach != 0 && base + stmt->left->reach > offset)
+        {
+            stmt = stmt->left;
+        }
+        else if (stmt->parseFailed && base + before + stmt->bytes + stmt->lookahead > offset)
+        {
+            return stmt;
+        }
+        else
+        {
+            base += before + stmt->bytes;
+            stmt = stmt->right;
+        }
+    }
+}
+
+IncrementalProgram::Statement* IncrementalProgram::locate(size_t offset) const
+{
+    // only the tail may be empty, and it is last, so a statement ending at
+    // offset is never the one wanted
+    Statement *stmt = statements;
+    for (;;)
+    {
+        size_t before = stmt->left != 0 ? stmt->left->totalBytes : 0;
+        if (offset < before)
+        {
+            stmt = stmt->left;
+        }
+        else if (offset < before + stmt->bytes || stmt->right == 0)
+        {
+            return stmt;
+        }
+        else
+        {
+            offset -= before + stmt->bytes;
+            stmt = stmt->right;
+        }
+    }
+}
+
+// Appends the tokens from pos on line up to the next semicolon, or to the end
+// of the source and its T_DONE; pos and line are moved past them
+// The characters are read exactly as getToken() reads them from a stream
+// Returns false if the source ended first
+static bool lexStatement(const GapBuffer& source, size_t& pos, int& line, std::vector<Token>& tokens)
+{
+    Lexer lexer(line);
+    Token tok;
+    bool putback;
+    bool semicolon = false;
+    while (pos < source.size() && !semicolon)
+    {
+        bool done = lexer.feed((unsigned char)source[pos], tok, putback);
+        // a character that ended the token is read again as the start of the next
+        if (!putback)
+        {
+            ++pos;
+        }
+        if (done)
+        {
+            tokens.push_back(tok);
+            semicolon = tok == T_SC;
+        }
+    }
+    if (!semicolon)
+    {
+        tokens.push_back(lexer.finish());
+    }
+    line = lexer.GetLinenum();
+    return semicolon;
+}
+
+// Lexes the statement starting at begin on line, or the tail if no semicolon is left
+IncrementalProgram::Statement* IncrementalProgram::lex(size_t begin, int line, std::vector<Token>& tokens)
+{
+    Statement *stmt = new Statement;
+    size_t end = begin;
+    int endLine = line;
+    stmt->tail = !lexStatement(text, end, endLine, tokens);
+    stmt->bytes = end - begin;
+    stmt->lines = endLine - line;
+    stmt->lookahead = 0;
+    stmt->tree = 0;
+    stmt->treeLine = line;
+    stmt->parseFailed = false;
+    stmt->checkFailed = false;
+    stmt->declared = NO_ATOM;
+    stmt->declaredType = ERROR_TYPE;
+    stmt->left = 0;
+    stmt->right = 0;
+    stmt->parent = 0;
+    stmt->priority = priorities();
+    update(stmt);
+    return stmt;
+}
+
+// Keeps what error() printed, as "line:message" lines, with lines relative to startLine
+void IncrementalProgram::keep(const string& printed, int startLine, std::vector<Diagnostic>& messages)
+{
+    messages.clear();
+    std::istringstream lines(printed);
+    string line;
+    while (std::getline(lines, line))
+    {
+        size_t colon = line.find(':');
+        Diagnostic diagnostic;
+        diagnostic.line = atoi(line.substr(0, colon).c_str()) - 1 - startLine;
+        diagnostic.message = line.substr(colon + 1);
+        messages.push_back(diagnostic);
+    }
+}
+
+// Parses the tokens of the statement at begin on line as StmtList() parses them,
+// and notes its names
+void IncrementalProgram::parse(Statement *stmt, std::vector<Token>& tokens, size_t begin, int line)
+{
+    // messages are printed without a file name into a context of their own
+    Context context;
+    Context *savedContext = theContext;
+    ostream *savedOutput = theOutput;
+    bool savedParseErrors = ::hasParseErrors;
+    int savedErrors = errorCount;
+    SemanticCheck *savedCheck = theFusedCheck;
+    NodeSharing *savedSharing = theNodeSharing;
+    std::ostringstream printed;
+    theContext = &context;
+    theOutput = &printed;
+    ::hasParseErrors = false;
+    theFusedCheck = 0;
+    theNodeSharing = 0;
+
+    size_t used;
+    size_t end = begin + stmt->bytes;
+    size_t lookaheadEnd = end;
+    int lookaheadLine = line + stmt->lines;
+    // after a syntax error inside parentheses the parser reads a token past the
+    // T_SC for every ( still open, so those are lexed before it starts: running
+    // out of tokens would unwind it and leak the nodes it built
+    int parens = 0;
+    for (const Token& tok : tokens)
+    {
+        parens += tok == T_LPAREN ? 1 : tok == T_RPAREN ? -1 : 0;
+    }
+    size_t statementTokens = tokens.size();
+    while (parens > 0 && lookaheadEnd < text.size() && tokens.size() - statementTokens < (size_t)parens)
+    {
+        lexStatement(text, lookaheadEnd, lookaheadLine, tokens);
+    }
+    for (;;)
+    {
+        try
+        {
+            stmt->tree = StmtFromTokens(tokens, used, stmt->tail || lookaheadEnd == text.size());
+            break;
+        }
+        catch (NeedMoreInput&)
+        {
+            // after a syntax error the parser reads on into the next statement
+            printed.str("");
+            ::hasParseErrors = false;
+            lexStatement(text, lookaheadEnd, lookaheadLine, tokens);
+        }
+    }
+    stmt->lookahead = lookaheadEnd - end;
+    stmt->parseFailed = ::hasParseErrors;
+
+    theContext = savedContext;
+    theOutput = savedOutput;
+    ::hasParseErrors = savedParseErrors;
+    errorCount = savedErrors;
+    theFusedCheck = savedCheck;
+    theNodeSharing = savedSharing;
+    keep(printed.str(), line, stmt->parseMessages);
+
+    if (stmt->parseFailed)
+    {
+        // a statement with a syntax error stops the parse, Prog() drops it
+        delete stmt->tree;
+        stmt->tree = 0;
+        return;
+    }
+    if (stmt->tree == 0)
+    {
+        return;
+    }
+    StatementNodes collector;
+    stmt->tree->accept(&collector);
+    for (size_t i = 0; i < collector.nodes.size(); ++i)
+    {
+        const ParseTree *node = collector.nodes[i].first;
+        if (collector.nodes[i].second == NODE_IDENTIFIER)
+        {
+            stmt->names.push_back(((const Identifier*)node)->getAtom());
+        }
+        else if (collector.nodes[i].second == NODE_DECLARATION)
+        {
+            const VariableDeclaration *declaration = (const VariableDeclaration*)node;
+            stmt->declared = declaration->getIdentifier()->getAtom();
+            stmt->declaredType = declaration->GetType();
+        }
+    }
+    std::sort(stmt->names.begin(), stmt->names.end());
+    stmt->names.erase(std::unique(stmt->names.begin(), stmt->names.end()), stmt->names.end());
+}
+
+// Checks a statement as check() does when it reaches it: the type table then
+// holds the first declaration of every name declared before it
+void IncrementalProgram::check(Statement *stmt)
+{
+    stmt->checkFailed = false;
+    stmt->checkMessages.clear();
+    if (stmt->tree == 0)
+    {
+        return;
+    }
+    Position at = position(stmt);
+    moveLines(stmt, at.line);
+
+    Context context;
+    for (Atom name : stmt->names)
+    {
+        const Name& entry = names[name];
+        if (!entry.declarations.empty() && position(entry.declarations.front()).index < at.index)
+        {
+            context.typeTable[name] = entry.declarations.front()->declaredType;
+        }
+    }
+    Context *savedContext = theContext;
+    ostream *savedOutput = theOutput;
+    int savedErrors = errorCount;
+    std::ostringstream printed;
+    theContext = &context;
+    theOutput = &printed;
+
+    SemanticCheck semanticCheck;
+    stmt->tree->accept(&semanticCheck);
+    stmt->checkFailed = !semanticCheck.isErrorFree();
+
+    theContext = savedContext;
+    theOutput = savedOutput;
+    errorCount = savedErrors;
+    keep(printed.str(), at.line, stmt->checkMessages);
+}
+
+// Brings the lines in the tree of a statement that moved to line up to date
+void IncrementalProgram::moveLines(Statement *stmt, int line)
+{
+    int delta = line - stmt->treeLine;
+    if (stmt->tree == 0 || delta == 0)
+    {
+        return;
+    }
+    StatementNodes collector;
+    stmt->tree->accept(&collector);
+    for (size_t i = 0; i < collector.nodes.size(); ++i)
+    {
+        const_cast<ParseTree*>(collector.nodes[i].first)->moveLines(delta);
+    }
+    stmt->treeLine = line;
+}
+
+void IncrementalProgram::addNames(Statement *stmt)
+{
+    for (Atom name : stmt->names)
+    {
+        names[name].users.insert(stmt);
+    }
+    if (stmt->declared != NO_ATOM)
+    {
+        names[stmt->declared].declarations.push_back(stmt);
+    }
+}
+
+// Forgets the names of a statement, noting the first declaration of every name
+// it declared, as it was before the edit
+void IncrementalProgram::removeNames(Statement *stmt, std::unordered_map<Atom, FirstDeclaration>& firstDeclarations)
+{
+    if (stmt->declared != NO_ATOM)
+    {
+        std::vector<Statement*>& declarations = names[stmt->declared].declarations;
+        FirstDeclaration first = { declarations.front(), declarations.front() == stmt, declarations.front()->declaredType };
+        firstDeclarations.insert(std::make_pair(stmt->declared, first));
+        declarations.erase(std::find(declarations.begin(), declarations.end(), stmt));
+    }
+    for (Atom name : stmt->names)
+    {
+        Name& entry = names[name];
+        entry.users.erase(stmt);
+        if (entry.users.empty() && entry.declarations.empty())
+        {
+            names.erase(name);
+        }
+    }
+}
+
+void IncrementalProgram::count(Statement *stmt, int sign)
+{
+    if (!stmt->checkMessages.empty() && sign > 0)
+    {
+        reported.insert(stmt);
+    }
+    else if (!stmt->checkMessages.empty())
+    {
+        reported.erase(stmt);
+    }
+    uncheckedStatements += sign * (stmt->checkFailed ? 1 : 0);
+    parsedStatements += sign * (stmt->tree != 0 ? 1 : 0);
+}
+
+void IncrementalProgram::edit(size_t offset, size_t removed, const string& inserted)
+{
+    offset = std::min(offset, text.size());
+    removed = std::min(removed, text.size() - offset);
+    // old positions after the removed bytes move by inserted.size() - removed
+    size_t removedEnd = offset + removed;
+    size_t insertedEnd = offset + inserted.size();
+
+    // the statement the edit starts in
+    Statement *first = locate(offset);
+    Position start = position(first);
+    // or an earlier one with a syntax error, if the parser read on into the edited bytes
+    if (Statement *reaching = failedReaching(offset))
+    {
+        Position at = position(reaching);
+        if (at.index < start.index)
+        {
+            first = reaching;
+            start = at;
+        }
+    }
+    text.replace(offset, removed, inserted);
+    sourceValid = false;
+
+    // lex statements again until one ends where an old statement past the edit ended;
+    // the replaced old statements are those from first on
+    std::vector<Statement*> added;
+    std::vector<std::vector<Token> > tokens;
+    size_t pos = start.begin;
+    int line = start.line;
+    // the old statement compared with the new ones, and where it ended before the edit
+    Statement *old = first;
+    size_t oldEnd = start.begin + old->bytes;
+    size_t replaced = 0;
+    for (;;)
+    {
+        tokens.push_back(std::vector<Token>());
+        Statement *stmt = lex(pos, line, tokens.back());
+        added.push_back(stmt);
+        pos += stmt->bytes;
+        line += stmt->lines;
+        if (stmt->tail)
+        {
+            replaced = statements->count - start.index;
+            break;
+        }
+        if (pos < insertedEnd)
+        {
+            continue;
+        }
+        while (!old->tail && (oldEnd < removedEnd || oldEnd - removedEnd + insertedEnd < pos))
+        {
+            old = next(old);
+            oldEnd += old->bytes;
+            ++replaced;
+        }
+        if (!old->tail && oldEnd >= removedEnd && oldEnd - removedEnd + insertedEnd == pos)
+        {
+            ++replaced;
+            break;
+        }
+    }
+
+    Statement *before;
+    Statement *rest;
+    Statement *dropped;
+    Statement *after;
+    split(statements, start.index, before, rest);
+    split(rest, replaced, dropped, after);
+    std::vector<Statement*> droppedStatements;
+    Statement *leftmost = dropped;
+    while (leftmost->left != 0)
+    {
+        leftmost = leftmost->left;
+    }
+    for (Statement *stmt = leftmost; stmt != 0; stmt = next(stmt))
+    {
+        droppedStatements.push_back(stmt);
+    }
+    std::unordered_map<Atom, FirstDeclaration> firstDeclarations;
+    for (Statement *stmt : droppedStatements)
+    {
+        removeNames(stmt, firstDeclarations);
+        count(stmt, -1);
+    }
+    deleteStatements(dropped);
+
+    // parsed before they join the tree, which sums their syntax errors
+    size_t begin = start.begin;
+    line = start.line;
+    for (size_t i = 0; i < added.size(); ++i)
+    {
+        parse(added[i], tokens[i], begin, line);
+        update(added[i]);
+        count(added[i], 1);
+        begin += added[i]->bytes;
+        line += added[i]->lines;
+    }
+    Statement *middle = 0;
+    for (Statement *stmt : added)
+    {
+        middle = merge(middle, stmt);
+    }
+    statements = merge(merge(before, middle), after);
+    statements->parent = 0;
+    for (Statement *stmt : added)
+    {
+        if (stmt->declared != NO_ATOM)
+        {
+            std::unordered_map<Atom, Name>::iterator entry = names.find(stmt->declared);
+            bool declared = entry != names.end() && !entry->second.declarations.empty();
+            FirstDeclaration previous = { declared ? entry->second.declarations.front() : 0, false, ERROR_TYPE };
+            firstDeclarations.insert(std::make_pair(stmt->declared, previous));
+        }
+    }
+    for (Statement *stmt : added)
+    {
+        addNames(stmt);
+    }
+
+    // the statements to check again: the new ones, and those mentioning a name
+    // whose first declaration is another one now; one the edit replaced by a
+    // new one of the same type is the same to every statement it kept
+    std::unordered_set<Statement*> unchecked(added.begin(), added.end());
+    for (std::unordered_map<Atom, FirstDeclaration>::iterator it = firstDeclarations.begin(); it != firstDeclarations.end(); ++it)
+    {
+        std::unordered_map<Atom, Name>::iterator entry = names.find(it->first);
+        if (entry == names.end())
+        {
+            continue;
+        }
+        std::vector<Statement*>& declarations = entry->second.declarations;
+        std::sort(declarations.begin(), declarations.end(),
+                  [](const Statement *a, const Statement *b) { return position(a).index < position(b).index; });
+        Statement *now = declarations.empty() ? 0 : declarations.front();
+        size_t nowIndex = now != 0 ? position(now).index : 0;
+        bool same = it->second.removed
+            ? now != 0 && nowIndex >= start.index && nowIndex < start.index + added.size() && now->declaredType == it->second.type
+            : now == it->second.kept;
+        if (!same)
+        {
+            unchecked.insert(entry->second.users.begin(), entry->second.users.end());
+        }
+    }
+    for (Statement *stmt : unchecked)
+    {
+        count(stmt, -1);
+        check(stmt);
+        count(stmt, 1);
+    }
+
+    freeList();
+    report.relexed = added.size();
+    report.rechecked = unchecked.size();
+    report.statements = statements->count;
+}
+
+bool IncrementalProgram::isChecked() const
+{
+    return statements->failures == 0 && parsedStatements != 0 && uncheckedStatements == 0;
+}
+
+void IncrementalProgram::printDiagnostics() const
+{
+    // the parse stops at the first statement with a syntax error, and nothing is checked
+    if (const Statement *first = firstFailed())
+    {
+        Position at = position(first);
+        for (const Diagnostic& diagnostic : first->parseMessages)
+        {
+            error(at.line + diagnostic.line, diagnostic.message);
+        }
+        return;
+    }
+    if (parsedStatements == 0)
+    {
+        return;
+    }
+    // the statements with messages, in source order
+    std::vector<std::pair<Position, const Statement*> > messages;
+    for (const Statement *stmt : reported)
+    {
+        messages.push_back(std::make_pair(position(stmt), stmt));
+    }
+    std::sort(messages.begin(), messages.end(),
+              [](const std::pair<Position, const Statement*>& a, const std::pair<Position, const Statement*>& b)
+              { return a.first.index < b.first.index; });
+    for (const std::pair<Position, const Statement*>& stmt : messages)
+    {
+        for (const Diagnostic& diagnostic : stmt.second->checkMessages)
+        {
+            error(stmt.first.line + diagnostic.line, diagnostic.message);
+        }
+    }
+}
+
+ParseTree* IncrementalProgram::program()
+{
+    if (listBuilt)
+    {
+        return list;
+    }
+    // StmtList() nests the list to the right, up to the first statement with a syntax error
+    const Statement *firstError = firstFailed();
+    size_t end = firstError != 0 ? position(firstError).index : statements->count;
+    std::vector<Statement*> parsed;
+    int line = 0;
+    Statement *stmt = firstStatement();
+    for (size_t i = 0; i < end; ++i, stmt = next(stmt))
+    {
+        if (stmt->tree != 0)
+        {
+            moveLines(stmt, line);
+            parsed.push_back(stmt);
+        }
+        line += stmt->lines;
+    }
+    for (size_t i = parsed.size(); i-- > 0; )
+    {
+        list = new StatementList(parsed[i]->tree, list);
+    }
+    listBuilt = true;
+    return list;
+}
+
+// Deletes the statement list program() built, but not the statements in it
+void IncrementalProgram::freeList()
+{
+    while (list != 0)
+    {
+        ParseTree *rest = list->getRight();
+        list->detachChildren();
+        delete list;
+        list = rest;
+    }
+    listBuilt = false;
+}
@@ -0,0 +1,213 @@
+#ifndef INCREMENTAL_H_
+#define INCREMENTAL_H_
+
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "parser.h"
+
+// Text with a gap at the last edit: an edit moves only the bytes between it and
+// the one before, so a run of edits near each other costs the size of the edits
+class GapBuffer
+{
+    string	text;
+    size_t	gapBegin;
+    size_t	gapEnd;
+
+public:
+    GapBuffer() : gapBegin(0), gapEnd(0) {}
+
+    size_t size() const { return text.size() - (gapEnd - gapBegin); }
+    char operator[](size_t pos) const { return text[pos < gapBegin ? pos : pos + (gapEnd - gapBegin)]; }
+
+    // Replaces removed bytes at offset with inserted, which must be within the text
+    void replace(size_t offset, size_t removed, const string& inserted);
+    string str() const;
+};
+
+// Incremental parse and check of a source being edited
+//
+// The source is kept as its statements: the bytes from just after one T_SC up
+// to and including the next. The lexer starts every token afresh and never
+// looks past a semicolon, so a statement lexes the same wherever it is, given
+// the line it starts on, and the text after the last semicolon is lexed on its
+// own to the end.
+//
+// An edit re-lexes from the start of the statement it begins in, statement by
+// statement, until it is past the inserted text and ends on the end of a
+// statement it didn't touch: from there on, the old statements are kept and
+// only moved. Only the statements lexed again are parsed again, and those with
+// a syntax error the parser read past their semicolon into the edit. A statement's
+// check only depends on its own tree and on the first declaration of each
+// name it mentions, so besides the new statements only those that mention a
+// name whose first declaration changed are checked again.
+//
+// A statement only knows its own length in bytes and lines, and the statements
+// form a balanced tree that sums them, so moving the statements after an edit
+// costs nothing and finding one costs the logarithm of their number; the
+// source is a GapBuffer. The tree also finds the first statement with a syntax
+// error, and the first whose parser read past a given byte, and the statements
+// with check messages are kept apart. The work of an edit, and of printing the
+// diagnostics after it, thus depends on what it touches and on the messages,
+// not on the size of the source.
+//
+// The diagnostics, and the program, are those Prog() and check() give for the
+// whole source: the syntax errors of the first statement that doesn't parse,
+// or else every message of the check. The lines of statements after an edit
+// that added or removed lines are updated in their trees only when the trees
+// are needed again.
+class IncrementalProgram
+{
+public:
+    // what the last edit did
+    struct EditReport
+    {
+        size_t	relexed;
+        size_t	rechecked;
+        size_t	statements;
+    };
+
+    IncrementalProgram();
+    explicit IncrementalProgram(const string& source);
+    ~IncrementalProgram();
+
+    // Replaces removed bytes at offset with inserted; both are clipped to the source
+    void edit(size_t offset, size_t removed, const string& inserted);
+
+    // The whole source, copied out of the gap buffer once after every edit
+    const string& getSource() const;
+    bool hasParseErrors() const { return statements->failures != 0; }
+    // true if Prog() gives a program and check() passes it, so it may be evaluated
+    bool isChecked() const;
+    const EditReport& lastEdit() const { return report; }
+
+    // Prints the messages Prog() and check() print for the source, through error()
+    void printDiagnostics() const;
+
+    // The program as Prog() returns it, or null
+    // It stays valid until the next edit
+    ParseTree* program();
+
+private:
+    struct Diagnostic
+    {
+        // relative to the first line of the statement
+        int		line;
+        string	message;
+    };
+
+    struct Statement
+    {
+        // the bytes of the statement, up to and including its semicolon, and the
+        // lines they span; where it is follows from those of the statements before it
+        size_t	bytes;
+        int		lines;
+        // the rest of the source after the last semicolon
+        bool	tail;
+
+        // a syntax error may make the parser read the tokens of the next
+        // statements; the bytes it read past the end of this one
+        size_t		lookahead;
+        // null if it has a syntax error, or if it is a tail without a statement
+        ParseTree	*tree;
+        // the line the tree was built for, the lines of its nodes are moved by its line - treeLine
+        int			treeLine;
+        bool		parseFailed;
+        bool		checkFailed;
+        std::vector<Diagnostic>	parseMessages;
+        std::vector<Diagnostic>	checkMessages;
+
+        // the name it declares, or NO_ATOM, and every name it mentions, once
+        Atom				declared;
+        TypeForNode			declaredType;
+        std::vector<Atom>	names;
+
+        // the statements are a treap in source order, a tree balanced by random
+        // priorities, every node holding the number, bytes and lines of its subtree,
+        // how many statements in it have a syntax error, and the furthest byte, from
+        // the start of the subtree, the parser read for one of those (0 if none)
+        Statement	*left;
+        Statement	*right;
+        Statement	*parent;
+        uint32_t	priority;
+        size_t		count;
+        size_t		totalBytes;
+        int			totalLines;
+        size_t		failures;
+        size_t		reach;
+    };
+
+    // where a statement is in the source
+    struct Position
+    {
+        size_t	index;
+        size_t	begin;
+        int		line;
+    };
+
+    // the statements mentioning a name, and those declaring it in source order
+    struct Name
+    {
+        std::vector<Statement*>			declarations;
+        std::unordered_set<Statement*>	users;
+    };
+
+    // the first declaration of a name before an edit: a statement kept, or
+    // the type of one the edit removed
+    struct FirstDeclaration
+    {
+        Statement	*kept;
+        bool		removed;
+        TypeForNode	type;
+    };
+
+    GapBuffer					text;
+    // getSource(), valid until the next edit
+    mutable string				source;
+    mutable bool				sourceValid;
+    // the root of the statements, the last is always the tail
+    Statement					*statements;
+    std::minstd_rand			priorities;
+    std::unordered_map<Atom, Name>	names;
+    // the statements with check messages
+    std::unordered_set<const Statement*>	reported;
+    size_t						uncheckedStatements;
+    size_t						parsedStatements;
+    // the statement list program() built, null if it has to be built again
+    ParseTree					*list;
+    bool						listBuilt;
+    EditReport					report;
+
+    IncrementalProgram(const IncrementalProgram&);
+    IncrementalProgram& operator=(const IncrementalProgram&);
+
+    Statement* lex(size_t begin, int line, std::vector<Token>& tokens);
+    static void keep(const string& printed, int startLine, std::vector<Diagnostic>& messages);
+    void parse(Statement *stmt, std::vector<Token>& tokens, size_t begin, int line);
+    void check(Statement *stmt);
+    static void moveLines(Statement *stmt, int line);
+    void addNames(Statement *stmt);
+    void removeNames(Statement *stmt, std::unordered_map<Atom, FirstDeclaration>& firstDeclarations);
+    void count(Statement *stmt, int sign);
+    void freeList();
+
+    static void update(Statement *node);
+    static Statement* merge(Statement *left, Statement *right);
+    // the first count statements of tree go to left, the others to right
+    static void split(Statement *tree, size_t count, Statement *&left, Statement *&right);
+    static Position position(const Statement *stmt);
+    static Statement* next(Statement *stmt);
+    static void deleteStatements(Statement *tree);
+    // the last statement starting at or before offset
+    Statement* locate(size_t offset) const;
+    Statement* firstStatement() const;
+    // the first statement with a syntax error, or null
+    Statement* firstFailed() const;
+    // the first statement with a syntax error whose parser read past offset, or null
+    Statement* failedReaching(size_t offset) const;
+};
+
+#endif /* INCREMENTAL_H_ */
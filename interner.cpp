@@ -0,0 +1,164 @@
+#include <string.h>
+
+#include "interner.h"
+#include "memory.h"
+
+// 32-bit FNV-1a
+static uint32_t hashText(std::string_view text)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        hash ^= (unsigned char)text[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+Interner::SlotTable::SlotTable(size_t size) : size(size), slots(new std::atomic<Atom>[size])
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        slots[i].store(NO_ATOM, std::memory_order_relaxed);
+    }
+}
+
+Interner::Interner(std::initializer_list<const char*> predefined)
+        : table(0), next(1), free(0), freeSize(0), chunkSize(FIRST_ARENA_CHUNK)
+{
+    MemoryScope scope(MEM_TOKENS);
+    tables.emplace_back(new SlotTable(64));
+    table.store(tables.back().get(), std::memory_order_release);
+    memset(blocks, 0, sizeof(blocks));
+    for (std::initializer_list<const char*>::const_iterator it = predefined.begin(); it != predefined.end(); ++it)
+    {
+        intern(*it);
+    }
+}
+
+Interner::~Interner()
+{
+    for (unsigned i = 0; i < BLOCK_COUNT && blocks[i] != 0; ++i)
+    {
+        delete[] blocks[i];
+    }
+    for (size_t i = 0; i < arena.size(); ++i)
+    {
+        delete[] arena[i];
+    }
+}
+
+size_t Interner::size() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return next - 1;
+}
+
+const char* Interner::store(std::string_view text)
+{
+    if (text.size() > freeSize)
+    {
+        // a spelling larger than a quarter of a chunk gets a chunk of its own
+        if (text.size() > chunkSize / 4)
+        {
+            char *memory = new char[text.size()];
+            arena.push_back(memory);
+            memcpy(memory, text.data(), text.size());
+            return memory;
+        }
+        char *memory = new char[chunkSize];
+        arena.push_back(memory);
+        free = memory;
+        freeSize = chunkSize;
+        chunkSize = chunkSize * 2 < ARENA_CHUNK ? chunkSize * 2 : ARENA_CHUNK;
+    }
+    char *stored = free;
+    memcpy(stored, text.data(), text.size());
+    free += text.size();
+    freeSize -= text.size();
+    return stored;
+}
+
+void Interner::grow()
+{
+    const SlotTable& slots = *table.load(std::memory_order_relaxed);
+    SlotTable *larger = new SlotTable(slots.size * 2);
+    tables.emplace_back(larger);
+    size_t mask = larger->size - 1;
+    for (size_t i = 0; i < slots.size; ++i)
+    {
+        Atom atom = slots.slots[i].load(std::memory_order_relaxed);
+        if (atom != NO_ATOM)
+        {
+            size_t slot = entry(atom).hash & mask;
+            while (larger->slots[slot].load(std::memory_order_relaxed) != NO_ATOM)
+            {
+                slot = (slot + 1) & mask;
+            }
+            larger->slots[slot].store(atom, std::memory_order_relaxed);
+        }
+    }
+    table.store(larger, std::memory_order_release);
+}
+
+size_t Interner::probe(const SlotTable& slots, std::string_view text, uint32_t hash, Atom& atom) const
+{
+    size_t mask = slots.size - 1;
+    size_t slot = hash & mask;
+    while ((atom = slots.slots[slot].load(std::memory_order_acquire)) != NO_ATOM)
+    {
+        const Entry& found = entry(atom);
+        if (found.hash == hash && found.length == text.size() && memcmp(found.data, text.data(), text.size()) == 0)
+        {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+Atom Interner::find(std::string_view text) const
+{
+    // an atom is stored in its slot only after its entry is complete, so whatever
+    // a probe sees is safe to compare, even while intern() adds to the table
+    const SlotTable& slots = *table.load(std::memory_order_acquire);
+    Atom atom;
+    probe(slots, text, hashText(text), atom);
+    return atom;
+}
+
+Atom Interner::intern(std::string_view text)
+{
+    uint32_t hash = hashText(text);
+    std::lock_guard<std::mutex> guard(lock);
+
+    SlotTable& slots = *table.load(std::memory_order_relaxed);
+    Atom existing;
+    size_t slot = probe(slots, text, hash, existing);
+    if (existing != NO_ATOM)
+    {
+        return existing;
+    }
+
+    // the entries, the arena and the hash table are memory of tokens, wherever they are interned
+    MemoryScope scope(MEM_TOKENS);
+    Atom atom = next++;
+    uint64_t index = atom + FIRST_BLOCK_SIZE;
+    unsigned blockIndex = blockOf(index);
+    Entry *&block = blocks[blockIndex];
+    if (block == 0)
+    {
+        block = new Entry[FIRST_BLOCK_SIZE << blockIndex];
+    }
+    Entry& added = block[index - (FIRST_BLOCK_SIZE << blockIndex)];
+    added.data = store(text);
+    added.length = text.size();
+    added.hash = hash;
+
+    slots.slots[slot].store(atom, std::memory_order_release);
+    if ((next - 1) * 2 > slots.size)
+    {
+        grow();
+    }
+    return atom;
+}
@@ -0,0 +1,117 @@
+#ifndef INTERNER_H_
+#define INTERNER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// Names and string constants are interned: every distinct spelling is stored
+// once and stands for a 32-bit atom, so they are compared and hashed as integers
+typedef uint32_t Atom;
+
+// never the atom of a spelling
+const Atom NO_ATOM = 0;
+
+// Interning table
+// An open-addressing hash table with linear probing maps spellings to atoms;
+// the spellings themselves are copied into an arena freed with the table.
+// intern() may be called by several threads at once. The spelling of an atom
+// never moves, and the hash table is published atomically, so spelling() and
+// find() take no lock.
+// An empty table is small, so a program may have one of its own, see theInterner.
+class Interner
+{
+public:
+    // predefined spellings get the atoms 1, 2, ... in order
+    Interner(std::initializer_list<const char*> predefined = {});
+    ~Interner();
+
+    Atom intern(std::string_view text);
+
+    // The atom of a spelling that was interned, or NO_ATOM; adds nothing
+    Atom find(std::string_view text) const;
+
+    std::string_view spelling(Atom atom) const
+    {
+        const Entry& found = entry(atom);
+        return std::string_view(found.data, found.length);
+    }
+
+    // number of distinct spellings
+    size_t size() const;
+
+private:
+    struct Entry
+    {
+        const char	*data;
+        uint32_t	length;
+        uint32_t	hash;
+    };
+
+    // block b holds FIRST_BLOCK_SIZE << b entries, so a few blocks cover every atom
+    static const unsigned FIRST_BLOCK_BITS = 6;
+    static const uint64_t FIRST_BLOCK_SIZE = 1u << FIRST_BLOCK_BITS;
+    static const unsigned BLOCK_COUNT = 33 - FIRST_BLOCK_BITS;
+    // arena chunks double from the first size up to the last one
+    static const size_t FIRST_ARENA_CHUNK = 1024;
+    static const size_t ARENA_CHUNK = 64 * 1024;
+
+    // atoms by hash, NO_ATOM marks an empty slot; never more than half full
+    struct SlotTable
+    {
+        size_t								size;
+        std::unique_ptr<std::atomic<Atom>[]>	slots;
+
+        explicit SlotTable(size_t size);
+    };
+
+    mutable std::mutex		lock;
+    // the table in use; find() may still probe one grow() replaced, so they are
+    // all kept until the interner goes, together half the size of the last
+    std::atomic<SlotTable*>	table;
+    std::vector<std::unique_ptr<SlotTable> >	tables;
+    // entries by atom, in blocks that stay where they are
+    Entry					*blocks[BLOCK_COUNT];
+    Atom					next;
+    // the arena chunks, the free space left in the last one and the size of the next
+    std::vector<char*>		arena;
+    char					*free;
+    size_t					freeSize;
+    size_t					chunkSize;
+
+    Interner(const Interner&);
+    Interner& operator=(const Interner&);
+
+    static unsigned blockOf(uint64_t index)
+    {
+        return 63 - __builtin_clzll(index) - FIRST_BLOCK_BITS;
+    }
+
+    const Entry& entry(Atom atom) const
+    {
+        uint64_t index = atom + FIRST_BLOCK_SIZE;
+        unsigned block = blockOf(index);
+        return blocks[block][index - (FIRST_BLOCK_SIZE << block)];
+    }
+
+    // the slot of the spelling in a table and its atom, or the empty slot
+    // where it would go and NO_ATOM
+    size_t probe(const SlotTable& slots, std::string_view text, uint32_t hash, Atom& atom) const;
+    const char* store(std::string_view text);
+    void grow();
+};
+
+// the interning table of the process, shared by all threads
+extern Interner theProcessInterner;
+
+// The table the names of this thread are interned in: theProcessInterner,
+// unless an embedded Program or a daemon request binds a table of its own
+// while it parses and runs, so its names are freed with it
+extern thread_local Interner *theInterner;
+
+#endif /* INTERNER_H_ */
@@ -1,10 +1,20 @@
 
 
+#include <array>
 #include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 #include <map>
 using std::map;
 
 #include "lexer.h"
+#include "memory.h"
+#include "probes.h"
+#include "utf8.h"
+
+thread_local int lineNumber = 0;
+
 static map<TokenType,string> tokenPrint = {
         { T_INT, "T_INT" },
         { T_STRING, "T_STRING" },
@@ -40,140 +50,377 @@ ostream& operator<<(ostream& out, const Token& tok) {
     return out;
 }
 //
-//
-static map<string,TokenType> kwmap = {
-        { "int", T_INT },
-        { "string", T_STRING },
-        { "set", T_SET },
-        { "print", T_PRINT },
-        { "println", T_PRINTLN },
-};
-
-Token
-id_or_kw(const string& lexeme)
-{
-    TokenType tt = T_ID;
+// The keywords are interned first in every table, so their atoms are 1 to KEYWORD_COUNT
+static const std::initializer_list<const char*> keywordSpellings = { "int", "string", "set", "print", "println" };
 
-    auto kIt = kwmap.find(lexeme);
-    if( kIt != kwmap.end() )
-        tt = kIt->second;
+Interner theProcessInterner(keywordSpellings);
+thread_local Interner *theInterner = &theProcessInterner;
 
-    return Token(tt, lexeme);
+Interner* newInterner()
+{
+    return new Interner(keywordSpellings);
 }
 
+static const TokenType keywordTypes[] = { T_INT, T_STRING, T_SET, T_PRINT, T_PRINTLN };
+static const Atom KEYWORD_COUNT = sizeof(keywordTypes) / sizeof(keywordTypes[0]);
 
 Token
-getToken(istream* br)
+id_or_kw(const string& lexeme, int line)
 {
-    enum LexState { BEGIN, INID, INSTRING, ININT, ONESLASH, INCOMMENT } lexstate = BEGIN;
-    string lexeme;
+    Atom atom = theInterner->intern(lexeme);
+    if( atom <= KEYWORD_COUNT )
+        return Token(keywordTypes[atom - 1], lexeme, line);
 
-    for(;;) {
-        int ch = br->get();
-        if( br->bad() || br->eof() ) break;
+    return Token(T_ID, atom, line);
+}
 
-        if( ch == '\n' ) {
-            extern int lineNumber;
-            ++lineNumber;
-        }
 
-        switch( lexstate ) {
-            case BEGIN:
-                if( isspace(ch) )
-                    continue;
+bool
+ReferenceLexer::feed(int ch, Token& tok, bool& putback)
+{
+    putback = false;
 
-                lexeme = ch;
+    if( ch == '\n' ) {
+        ++line;
+    }
 
-                if( isalpha(ch) ) {
-                    lexstate = INID;
-                }
-                else if( ch == '"' ) {
-                    lexstate = INSTRING;
-                }
-                else if( isdigit(ch) ) {
-                    lexstate = ININT;
-                }
-                else if( ch == '/' ) {
-                    lexstate = ONESLASH;
-                }
-                else {
-                    TokenType tt = T_ERROR;
-                    switch( ch ) {
-                        case '+':
-                            tt = T_PLUS;
-                            break;
-                        case '-':
-                            tt = T_MINUS;
-                            break;
-                        case '*':
-                            tt = T_STAR;
-                            break;
-                        case '(':
-                            tt = T_LPAREN;
-                            break;
-                        case ')':
-                            tt = T_RPAREN;
-                            break;
-                        case ';':
-                            tt = T_SC;
-                            break;
-                    }
-
-                    return Token(tt, lexeme);
-                }
-                break;
+    switch( lexstate ) {
+        case BEGIN:
+            if( isspace(ch) )
+                return false;
 
-            case INID:
-                if( isalpha(ch) || isdigit(ch) ) {
-                    lexeme += ch;
-                }
-                else {
-                    br->putback(ch);
-                    return id_or_kw(lexeme);
+            lexeme = ch;
+
+            if( isalpha(ch) ) {
+                lexstate = INID;
+            }
+            else if( ch == '"' ) {
+                lexstate = INSTRING;
+            }
+            else if( isdigit(ch) ) {
+                lexstate = ININT;
+            }
+            else if( ch == '/' ) {
+                lexstate = ONESLASH;
+            }
+            else {
+                TokenType tt = T_ERROR;
+                switch( ch ) {
+                    case '+':
+                        tt = T_PLUS;
+                        break;
+                    case '-':
+                        tt = T_MINUS;
+                        break;
+                    case '*':
+                        tt = T_STAR;
+                        break;
+                    case '(':
+                        tt = T_LPAREN;
+                        break;
+                    case ')':
+                        tt = T_RPAREN;
+                        break;
+                    case ';':
+                        tt = T_SC;
+                        break;
                 }
-                break;
 
-            case INSTRING:
+                tok = Token(tt, lexeme, line);
+                return true;
+            }
+            return false;
+
+        case INID:
+            if( isalpha(ch) || isdigit(ch) ) {
                 lexeme += ch;
-                if( ch == '\n' ) {
-                    return Token(T_ERROR, lexeme );
-                }
-                if( ch == '"' ) {
-                    return Token(T_SCONST, lexeme );
-                }
-                break;
+                return false;
+            }
+            putback = true;
+            tok = id_or_kw(lexeme, line);
+            break;
 
-            case ININT:
-                if( isdigit(ch) ) {
-                    lexeme += ch;
-                }
-                else if( isalpha(ch) ) {
-                    lexeme += ch;
-                    return Token(T_ERROR, lexeme);
-                }
-                else {
-                    br->putback(ch);
-                    return Token(T_ICONST, lexeme);
-                }
+        case INSTRING:
+            lexeme += ch;
+            if( ch == '\n' ) {
+                tok = Token(T_ERROR, lexeme, line);
                 break;
-
-            case ONESLASH:
-                if( ch != '/' ) {
-                    br->putback(ch);
-                    return Token(T_SLASH, lexeme );
-                }
-                lexstate = INCOMMENT;
+            }
+            if( ch == '"' ) {
+                if( !validUtf8Scalar(lexeme.data() + 1, lexeme.size() - 2) )
+                    tok = Token(T_ERROR, lexeme, LEX_INVALID_UTF8, line);
+                else
+                    tok = Token(T_SCONST, theInterner->intern(std::string_view(lexeme).substr(1, lexeme.size() - 2)), line);
                 break;
+            }
+            return false;
 
-            case INCOMMENT:
-                if( ch == '\n' ) {
-                    lexstate = BEGIN;
-                }
+        case ININT:
+            if( isdigit(ch) ) {
+                lexeme += ch;
+                return false;
+            }
+            else if( isalpha(ch) ) {
+                lexeme += ch;
+                tok = Token(T_ERROR, lexeme, line);
+            }
+            else {
+                putback = true;
+                errno = 0;
+                long long value = strtoll(lexeme.c_str(), 0, 10);
+                if( errno == ERANGE || value > INT_MAX )
+                    tok = Token(T_ERROR, lexeme, line);
+                else
+                    tok = Token(T_ICONST, lexeme, (int)value, line);
+            }
+            break;
+
+        case ONESLASH:
+            if( ch != '/' ) {
+                putback = true;
+                tok = Token(T_SLASH, lexeme, line);
                 break;
-        }
+            }
+            lexstate = INCOMMENT;
+            return false;
 
+        case INCOMMENT:
+            if( ch == '\n' ) {
+                lexstate = BEGIN;
+            }
+            return false;
+    }
+
+    lexstate = BEGIN;
+    return true;
+}
+
+
+
+// Character classes of the table-driven lexer
+enum CharClass { C_SPACE, C_NEWLINE, C_ALPHA, C_DIGIT, C_QUOTE, C_SLASH,
+                 C_PLUS, C_MINUS, C_STAR, C_LPAREN, C_RPAREN, C_SC, C_OTHER, CLASS_COUNT };
+
+// What a transition does with the character
+enum LexAction {
+    A_SKIP,			// nothing
+    A_START,		// starts the lexeme
+    A_START_INT,	// starts the lexeme and the value of an integer constant
+    A_APPEND,		// appends to the lexeme
+    A_APPEND_DIGIT,	// appends to the lexeme and the value of an integer constant
+    A_EMIT_CHAR,	// emits the character alone as a token
+    A_EMIT_WITH,	// appends to the lexeme and emits it
+    A_EMIT_BEFORE	// emits the lexeme and puts the character back
+};
+
+struct Transition {
+    unsigned char	next;
+    unsigned char	action;
+    unsigned char	token;
+};
+
+typedef std::array<unsigned char, 256> ClassMap;
+typedef std::array<std::array<Transition, CLASS_COUNT>, LEXSTATE_COUNT> TransitionTable;
+
+// The same classes as isspace, isalpha and isdigit in the C locale
+static constexpr ClassMap buildClassMap()
+{
+    ClassMap classes = {};
+    for( int ch = 0; ch < 256; ++ch ) {
+        CharClass cls = C_OTHER;
+        if( ch == '\n' ) cls = C_NEWLINE;
+        else if( ch == ' ' || ch == '\t' || ch == '\v' || ch == '\f' || ch == '\r' ) cls = C_SPACE;
+        else if( (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ) cls = C_ALPHA;
+        else if( ch >= '0' && ch <= '9' ) cls = C_DIGIT;
+        else if( ch == '"' ) cls = C_QUOTE;
+        else if( ch == '/' ) cls = C_SLASH;
+        else if( ch == '+' ) cls = C_PLUS;
+        else if( ch == '-' ) cls = C_MINUS;
+        else if( ch == '*' ) cls = C_STAR;
+        else if( ch == '(' ) cls = C_LPAREN;
+        else if( ch == ')' ) cls = C_RPAREN;
+        else if( ch == ';' ) cls = C_SC;
+        classes[ch] = (unsigned char)cls;
     }
-    if( br->eof() ) return T_DONE;
-    return T_ERROR;
+    return classes;
 }
 
+static constexpr void setRow(TransitionTable& table, LexState state, LexState next, LexAction action, TokenType token = T_ERROR)
+{
+    for( int cls = 0; cls < CLASS_COUNT; ++cls )
+        table[state][cls] = Transition{ (unsigned char)next, (unsigned char)action, (unsigned char)token };
+}
+
+static constexpr void set(TransitionTable& table, LexState state, CharClass cls, LexState next, LexAction action,
+                          TokenType token = T_ERROR)
+{
+    table[state][cls] = Transition{ (unsigned char)next, (unsigned char)action, (unsigned char)token };
+}
+
+// The transitions of ReferenceLexer::feed
+static constexpr TransitionTable buildTransitions()
+{
+    TransitionTable table = {};
+
+    setRow(table, BEGIN, BEGIN, A_EMIT_CHAR, T_ERROR);
+    set(table, BEGIN, C_SPACE, BEGIN, A_SKIP);
+    set(table, BEGIN, C_NEWLINE, BEGIN, A_SKIP);
+    set(table, BEGIN, C_ALPHA, INID, A_START);
+    set(table, BEGIN, C_QUOTE, INSTRING, A_START);
+    set(table, BEGIN, C_DIGIT, ININT, A_START_INT);
+    set(table, BEGIN, C_SLASH, ONESLASH, A_START);
+    set(table, BEGIN, C_PLUS, BEGIN, A_EMIT_CHAR, T_PLUS);
+    set(table, BEGIN, C_MINUS, BEGIN, A_EMIT_CHAR, T_MINUS);
+    set(table, BEGIN, C_STAR, BEGIN, A_EMIT_CHAR, T_STAR);
+    set(table, BEGIN, C_LPAREN, BEGIN, A_EMIT_CHAR, T_LPAREN);
+    set(table, BEGIN, C_RPAREN, BEGIN, A_EMIT_CHAR, T_RPAREN);
+    set(table, BEGIN, C_SC, BEGIN, A_EMIT_CHAR, T_SC);
+
+    setRow(table, INID, BEGIN, A_EMIT_BEFORE, T_ID);
+    set(table, INID, C_ALPHA, INID, A_APPEND);
+    set(table, INID, C_DIGIT, INID, A_APPEND);
+
+    setRow(table, INSTRING, INSTRING, A_APPEND);
+    set(table, INSTRING, C_NEWLINE, BEGIN, A_EMIT_WITH, T_ERROR);
+    set(table, INSTRING, C_QUOTE, BEGIN, A_EMIT_WITH, T_SCONST);
+
+    setRow(table, ININT, BEGIN, A_EMIT_BEFORE, T_ICONST);
+    set(table, ININT, C_DIGIT, ININT, A_APPEND_DIGIT);
+    set(table, ININT, C_ALPHA, BEGIN, A_EMIT_WITH, T_ERROR);
+
+    setRow(table, ONESLASH, BEGIN, A_EMIT_BEFORE, T_SLASH);
+    set(table, ONESLASH, C_SLASH, INCOMMENT, A_SKIP);
+
+    setRow(table, INCOMMENT, INCOMMENT, A_SKIP);
+    set(table, INCOMMENT, C_NEWLINE, BEGIN, A_SKIP);
+
+    return table;
+}
+
+static constexpr ClassMap charClasses = buildClassMap();
+static constexpr TransitionTable transitions = buildTransitions();
+
+static_assert(charClasses['_'] == C_OTHER && charClasses['7'] == C_DIGIT, "character classes");
+static_assert(transitions[INCOMMENT][C_NEWLINE].next == BEGIN, "transition table");
+
+
+bool
+Lexer::feed(int ch, Token& tok, bool& putback)
+{
+#ifdef LEXER_CROSSCHECK
+    Token expected;
+    bool expectedPutback;
+    bool expectedDone = reference.feed(ch, expected, expectedPutback);
+    bool done = step(ch, tok, putback);
+    if( done != expectedDone || reference.GetLinenum() != line ||
+        (done && (putback != expectedPutback || tok.GetTokenType() != expected.GetTokenType() ||
+                  tok.GetLexeme() != expected.GetLexeme() || tok.GetIntValue() != expected.GetIntValue() ||
+                  tok.GetLinenum() != expected.GetLinenum())) ) {
+        std::cerr << "lexer mismatch at line " << line << " on character " << ch << ": " << (done ? tok : Token())
+                  << " but reference " << (expectedDone ? expected : Token()) << std::endl;
+        abort();
+    }
+    return done;
+#else
+    return step(ch, tok, putback);
+#endif
+}
+
+
+bool
+Lexer::step(int ch, Token& tok, bool& putback)
+{
+    putback = false;
+
+    unsigned char cls = charClasses[(unsigned char)ch];
+    if( cls == C_NEWLINE ) {
+        ++line;
+    }
+
+    const Transition& transition = transitions[lexstate][cls];
+    LexState state = lexstate;
+    lexstate = (LexState)transition.next;
+
+    switch( transition.action ) {
+        case A_SKIP:
+            return false;
+
+        case A_START:
+            lexeme = ch;
+            return false;
+
+        case A_START_INT:
+            lexeme = ch;
+            value = ch - '0';
+            overflow = false;
+            return false;
+
+        case A_APPEND:
+            lexeme += ch;
+            return false;
+
+        case A_APPEND_DIGIT:
+            lexeme += ch;
+            if( value > (INT_MAX - (ch - '0')) / 10 )
+                overflow = true;
+            else
+                value = value * 10 + (ch - '0');
+            return false;
+
+        case A_EMIT_CHAR:
+            lexeme = ch;
+            tok = Token((TokenType)transition.token, lexeme, line);
+            return true;
+
+        case A_EMIT_WITH:
+            lexeme += ch;
+            if( transition.token == T_SCONST && !validUtf8(lexeme.data() + 1, lexeme.size() - 2) )
+                tok = Token(T_ERROR, lexeme, LEX_INVALID_UTF8, line);
+            else if( transition.token == T_SCONST )
+                tok = Token(T_SCONST, theInterner->intern(std::string_view(lexeme).substr(1, lexeme.size() - 2)), line);
+            else
+                tok = Token((TokenType)transition.token, lexeme, line);
+            return true;
+
+        case A_EMIT_BEFORE:
+            putback = true;
+            if( state == INID )
+                tok = id_or_kw(lexeme, line);
+            else if( state == ININT && !overflow )
+                tok = Token(T_ICONST, lexeme, value, line);
+            else
+                tok = Token(state == ININT ? T_ERROR : (TokenType)transition.token, lexeme, line);
+            return true;
+    }
+    return false;
+}
+
+
+Token
+getToken(istream* br)
+{
+    // every call starts a new token, which the stream is positioned at
+    MemoryScope scope(MEM_TOKENS);
+    Lexer lexer(lineNumber);
+    Token tok;
+    bool putback;
+
+    for(;;) {
+        int ch = br->get();
+        if( br->bad() || br->eof() ) break;
+
+        bool done = lexer.feed(ch, tok, putback);
+        lineNumber = lexer.GetLinenum();
+        if( done ) {
+            // a character that ended the token belongs to the next one;
+            // reading it again counts its newline again, as it always has
+            if( putback )
+                br->putback(ch);
+            PARSER_PROBE2(token, (int)tok.GetTokenType(), tok.GetLinenum()+1);
+            return tok;
+        }
+    }
+    TokenType tt = br->eof() ? T_DONE : T_ERROR;
+    PARSER_PROBE2(token, (int)tt, lineNumber+1);
+    return tt;
+}
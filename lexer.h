@@ -9,6 +9,8 @@ using std::string;
 using std::istream;
 using std::ostream;
 
+#include "interner.h"
+
 enum TokenType {
     // keywords
             T_INT,
@@ -40,28 +42,120 @@ enum TokenType {
             T_DONE
 };
 
+// what a T_ERROR token carries as its value
+enum LexError {
+    // a character or lexeme that isn't a token
+    LEX_BAD_TOKEN,
+    // a string constant whose bytes are not valid UTF-8, see utf8.h
+    LEX_INVALID_UTF8
+};
+
+// current line of the input being lexed on this thread
+extern thread_local int lineNumber;
+
 class Token {
     TokenType	tt;
     string		lexeme;
+    // identifiers and string constants carry the atom of their name or body instead of a lexeme
+    Atom		atom;
+    // integer constants carry their value, decoded by the lexer
+    int			value;
     int			lnum;
 
 public:
-    Token(TokenType tt = T_ERROR, string lexeme = "") : tt(tt), lexeme(lexeme) {
-        extern int lineNumber;
+    Token(TokenType tt = T_ERROR, string lexeme = "") : tt(tt), lexeme(lexeme), atom(NO_ATOM), value(0) {
         lnum = lineNumber;
     }
+    Token(TokenType tt, const string& lexeme, int lnum) : tt(tt), lexeme(lexeme), atom(NO_ATOM), value(0), lnum(lnum) {}
+    Token(TokenType tt, const string& lexeme, int value, int lnum)
+            : tt(tt), lexeme(lexeme), atom(NO_ATOM), value(value), lnum(lnum) {}
+    Token(TokenType tt, Atom atom, int lnum) : tt(tt), atom(atom), value(0), lnum(lnum) {}
 
     bool operator==(const TokenType tt) const { return this->tt == tt; }
     bool operator!=(const TokenType tt) const { return this->tt != tt; }
 
     TokenType	GetTokenType() const { return tt; }
-    string		GetLexeme() const { return lexeme; }
+    Atom		GetAtom() const { return atom; }
+    int			GetIntValue() const { return value; }
+    string		GetLexeme() const
+    {
+        if (atom == NO_ATOM)
+        {
+            return lexeme;
+        }
+        string text(theInterner->spelling(atom));
+        return tt == T_SCONST ? '"' + text + '"' : text;
+    }
     int			GetLinenum() const { return lnum; }
 };
 
 extern ostream& operator<<(ostream& out, const Token& tok);
 
+enum LexState { BEGIN, INID, INSTRING, ININT, ONESLASH, INCOMMENT };
+const int LEXSTATE_COUNT = INCOMMENT + 1;
+
+// The original branching state machine, kept as the reference the table-driven
+// Lexer is checked against when built with -DLEXER_CROSSCHECK
+class ReferenceLexer {
+public:
+    explicit ReferenceLexer(int line = 0) : lexstate(BEGIN), line(line) {}
+
+    bool feed(int ch, Token& tok, bool& putback);
+
+    int GetLinenum() const { return line; }
+
+private:
+    LexState	lexstate;
+    string		lexeme;
+    int			line;
+};
+
+// Resumable lexer state machine
+// The lexer never reads input itself: characters are fed to it one at a time,
+// so it can be driven from a blocking stream as well as from chunks of input
+// that split tokens, strings and comments at any byte
+// Every character is looked up in a 256-entry class map, and the state and the
+// class select the transition from a table built at compile time. Integer
+// constants are decoded while they are scanned; one that doesn't fit an int is
+// a T_ERROR token.
+class Lexer {
+public:
+    explicit Lexer(int line = 0) : lexstate(BEGIN), value(0), overflow(false), line(line)
+#ifdef LEXER_CROSSCHECK
+            , reference(line)
+#endif
+    {}
+
+    // Feeds the next character
+    // Returns true if it completed a token, which is stored in tok.
+    // If the token ended just before ch, ch was not consumed: putback is set
+    // and ch must be fed again.
+    bool feed(int ch, Token& tok, bool& putback);
+
+    // The token that ends the input
+    // Like getToken, a token still in progress at the end of input is dropped
+    Token finish() const { return Token(T_DONE, "", line); }
+
+    int GetLinenum() const { return line; }
+
+private:
+    LexState	lexstate;
+    string		lexeme;
+    // the value of the integer constant being scanned, and whether it overflowed
+    int			value;
+    bool		overflow;
+    int			line;
+#ifdef LEXER_CROSSCHECK
+    ReferenceLexer	reference;
+#endif
+
+    bool step(int ch, Token& tok, bool& putback);
+};
+
 extern Token getToken(istream* br);
 
+// A new interning table for names of their own, with the keywords the lexer expects
+extern Interner* newInterner();
+
 
 #endif /* LEXER_H_ */
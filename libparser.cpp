@@ -0,0 +1,225 @@
+#include <new>
+
+#include "libparser.h"
+#include "program.h"
+
+// Hands everything written to it to the write callback of an execution,
+// a full buffer at a time and on every flush
+class CallbackBuffer : public std::streambuf
+{
+    parser_write_fn	write;
+    void			*user;
+    char			buffer[16 * 1024];
+
+    void send()
+    {
+        size_t pending = pptr() - pbase();
+        setp(buffer, buffer + sizeof(buffer));
+        if (pending != 0)
+        {
+            write(user, buffer, pending);
+        }
+    }
+
+protected:
+    virtual int_type overflow(int_type ch)
+    {
+        send();
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    virtual int sync()
+    {
+        send();
+        return 0;
+    }
+
+public:
+    CallbackBuffer(parser_write_fn write, void *user) : write(write), user(user)
+    {
+        setp(buffer, buffer + sizeof(buffer));
+    }
+};
+
+struct parser_program
+{
+    Program program;
+
+    parser_program(const string& source, const string& name) : program(source, name) {}
+};
+
+struct parser_execution
+{
+    CallbackBuffer	buffer;
+    ostream			out;
+    Execution		execution;
+
+    parser_execution(const Program& program, parser_write_fn write, void *user)
+            : buffer(write, user), out(&buffer), execution(program, out)
+    {
+    }
+};
+
+struct parser_session
+{
+    EditSession session;
+
+    parser_session(const string& source, const string& name) : session(source, name) {}
+};
+
+int parser_api_version(void)
+{
+    return PARSER_API_VERSION;
+}
+
+parser_program* parser_compile(const char *source, size_t size, const char *name)
+{
+    try
+    {
+        return new parser_program(string(source, size), name != 0 ? name : "");
+    }
+    catch (...)
+    {
+        return 0;
+    }
+}
+
+void parser_program_free(parser_program *program)
+{
+    delete program;
+}
+
+int parser_program_runnable(const parser_program *program)
+{
+    return program->program.isRunnable() ? 1 : 0;
+}
+
+int parser_program_status(const parser_program *program)
+{
+    return program->program.getStatus();
+}
+
+const char* parser_program_diagnostics(const parser_program *program, size_t *size)
+{
+    *size = program->program.getDiagnostics().size();
+    return program->program.getDiagnostics().c_str();
+}
+
+parser_execution* parser_execution_new(const parser_program *program, parser_write_fn write, void *user)
+{
+    return new (std::nothrow) parser_execution(program->program, write, user);
+}
+
+void parser_execution_free(parser_execution *execution)
+{
+    delete execution;
+}
+
+void parser_execution_limit(parser_execution *execution, size_t max_value_bytes,
+                            size_t max_string_bytes, unsigned long time_limit_ms)
+{
+    ResourceLimits limits;
+    limits.maxValueBytes = max_value_bytes;
+    limits.maxStringBytes = max_string_bytes;
+    limits.timeLimit = std::chrono::milliseconds(time_limit_ms);
+    execution->execution.setLimits(limits);
+}
+
+int parser_execution_run(parser_execution *execution)
+{
+    try
+    {
+        return execution->execution.run() ? 0 : 1;
+    }
+    catch (...)
+    {
+        return -1;
+    }
+}
+
+void parser_execution_reset(parser_execution *execution)
+{
+    execution->execution.reset();
+}
+
+int parser_execution_get_int(const parser_execution *execution, const char *name, int *value)
+{
+    const Value *variable = execution->execution.variable(name);
+    if (variable == 0 || variable->type != INT_TYPE)
+    {
+        return -1;
+    }
+    *value = variable->intValue;
+    return 0;
+}
+
+const char* parser_execution_get_string(const parser_execution *execution, const char *name, size_t *size)
+{
+    const Value *variable = execution->execution.variable(name);
+    if (variable == 0 || variable->type != STRING_TYPE)
+    {
+        return 0;
+    }
+    *size = variable->stringValue.size();
+    return variable->stringValue.c_str();
+}
+
+parser_session* parser_session_new(const char *source, size_t size, const char *name)
+{
+    try
+    {
+        return new parser_session(string(source, size), name != 0 ? name : "");
+    }
+    catch (...)
+    {
+        return 0;
+    }
+}
+
+void parser_session_free(parser_session *session)
+{
+    delete session;
+}
+
+int parser_session_edit(parser_session *session, size_t offset, size_t removed,
+                        const char *text, size_t size)
+{
+    try
+    {
+        session->session.edit(offset, removed, string(text, size));
+        return 0;
+    }
+    catch (...)
+    {
+        return -1;
+    }
+}
+
+const char* parser_session_source(const parser_session *session, size_t *size)
+{
+    try
+    {
+        *size = session->session.getSource().size();
+        return session->session.getSource().c_str();
+    }
+    catch (...)
+    {
+        return 0;
+    }
+}
+
+int parser_session_checked(const parser_session *session)
+{
+    return session->session.isChecked() ? 1 : 0;
+}
+
+const char* parser_session_diagnostics(const parser_session *session, size_t *size)
+{
+    *size = session->session.getDiagnostics().size();
+    return session->session.getDiagnostics().c_str();
+}
@@ -0,0 +1,120 @@
+#ifndef LIBPARSER_H_
+#define LIBPARSER_H_
+
+#include <stddef.h>
+
+/*
+ * C interface of the embeddable interpreter, see program.h
+ *
+ * Programs are compiled once and run through executions: a program may be
+ * run by any number of threads at once, each through its own execution; one
+ * execution is used by one thread at a time. Handles are opaque, and no
+ * function throws or aborts on bad input: they return NULL or -1 instead.
+ *
+ * Everything an execution prints goes to its write callback, which is called
+ * with the bytes in order, at the latest before parser_execution_run returns.
+ *
+ * A session keeps a source an editor changes parsed and checked: an edit
+ * parses and checks again only the statements it touched, so its cost doesn't
+ * grow with the size of the source. One thread at a time may use a session.
+ * The interface only grows: PARSER_API_VERSION is bumped when functions are
+ * added, and existing ones never change.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define PARSER_API __attribute__((visibility("default")))
+#else
+#define PARSER_API
+#endif
+
+#define PARSER_API_VERSION 2
+
+typedef struct parser_program parser_program;
+typedef struct parser_execution parser_execution;
+typedef struct parser_session parser_session;
+
+/* receives the next size bytes of output */
+typedef void (*parser_write_fn)(void *user, const char *data, size_t size);
+
+/* the PARSER_API_VERSION the library was built with */
+PARSER_API int parser_api_version(void);
+
+/*
+ * Parses and checks size bytes of source; name prefixes its messages unless
+ * it is NULL or empty. Returns NULL only if memory ran out: a program with
+ * errors is returned too, see parser_program_runnable.
+ */
+PARSER_API parser_program* parser_compile(const char *source, size_t size, const char *name);
+PARSER_API void parser_program_free(parser_program *program);
+
+/* 1 if the program parsed and passed the check, 0 if not */
+PARSER_API int parser_program_runnable(const parser_program *program);
+/* the exit status of the command line interpreter before the program runs */
+PARSER_API int parser_program_status(const parser_program *program);
+/* the messages of the parse and the check, valid as long as the program */
+PARSER_API const char* parser_program_diagnostics(const parser_program *program, size_t *size);
+
+/* an execution of program, which must outlive it, printing through write */
+PARSER_API parser_execution* parser_execution_new(const parser_program *program, parser_write_fn write, void *user);
+PARSER_API void parser_execution_free(parser_execution *execution);
+
+/*
+ * Limits every later run of the execution; 0 is no limit. A run past a limit
+ * stops with a runtime error on the line that exceeded it.
+ */
+PARSER_API void parser_execution_limit(parser_execution *execution, size_t max_value_bytes,
+                                       size_t max_string_bytes, unsigned long time_limit_ms);
+
+/*
+ * Runs the program on the variables the last run left. Returns 0 if every
+ * statement ran, 1 if a runtime error stopped it or the program isn't
+ * runnable, -1 if memory ran out.
+ */
+PARSER_API int parser_execution_run(parser_execution *execution);
+/* forgets every variable */
+PARSER_API void parser_execution_reset(parser_execution *execution);
+
+/*
+ * The value of an integer variable after a run: returns 0 and sets *value,
+ * or -1 if no run declared an integer variable of that name.
+ */
+PARSER_API int parser_execution_get_int(const parser_execution *execution, const char *name, int *value);
+/*
+ * The value of a string variable after a run, with its length in *size, or
+ * NULL; valid until the next run or reset.
+ */
+PARSER_API const char* parser_execution_get_string(const parser_execution *execution, const char *name, size_t *size);
+
+/*
+ * A session on size bytes of source; name prefixes its messages unless it is
+ * NULL or empty. Returns NULL if memory ran out.
+ */
+PARSER_API parser_session* parser_session_new(const char *source, size_t size, const char *name);
+PARSER_API void parser_session_free(parser_session *session);
+
+/*
+ * Replaces removed bytes at offset with the size bytes of text; the range is
+ * clipped to the source. Returns 0, or -1 if memory ran out, after which the
+ * session may only be freed.
+ */
+PARSER_API int parser_session_edit(parser_session *session, size_t offset, size_t removed,
+                                   const char *text, size_t size);
+/* the source after the last edit, valid until the next edit, or NULL if memory ran out */
+PARSER_API const char* parser_session_source(const parser_session *session, size_t *size);
+/* 1 if the source parses and passes the check, 0 if not or if it has no statement */
+PARSER_API int parser_session_checked(const parser_session *session);
+/*
+ * The messages parser_compile gives for the source now, valid until the next
+ * edit
+ */
+PARSER_API const char* parser_session_diagnostics(const parser_session *session, size_t *size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBPARSER_H_ */
@@ -1,145 +1,336 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <set>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
 
 using namespace std;
 
 #include "parser.h"
+#include "cache.h"
+#include "semantic.h"
+#include "asyncinput.h"
+#include "deadstore.h"
+#include "parallel.h"
+#include "forkjoin.h"
+#include "parallelcheck.h"
+#include "share.h"
+#include "stats.h"
+#include "profile.h"
+#include "governor.h"
+#include "batch.h"
+#include "snapshot.h"
 
-int lineNumber = 0;
-//bool shouldTrace = false;
-bool hasParseErrors = false;
 string *theInputFileName = 0;
 
-map<string, Value> symbolTable;
-map<string, TypeForNode> typeTable;
-
-// Print the parse error to standard output
-// If the input is file (as indicated by non-null theInputFileName pointer),
-// prepend the error message with "filename:"
-void error(int linenum, const string& message)
+// Parses and checks the program: while parsing if fused is set, otherwise
+// afterwards, on pool if there is one and on this thread if not
+// Sets checked if the returned tree passed the semantic check
+ParseTree* compile(istream *in, WorkStealingPool *pool, bool fused, bool& checked)
 {
-    if (theInputFileName)
+    checked = false;
+    if (fused)
+    {
+        PhaseTimer timer(PHASE_PARSE);
+        return parseAndCheck(in, checked);
+    }
+    ParseTree *tree;
     {
-        cout << *theInputFileName << ":";
+        PhaseTimer timer(PHASE_PARSE);
+        tree = Prog(in);
     }
-    cout << linenum+1 << ":" << message << endl;
+    if (tree != 0 && !hasParseErrors)
+    {
+        PhaseTimer timer(PHASE_CHECK);
+        checked = pool != 0 ? checkParallel(tree, *pool) : check(tree);
+    }
+    return tree;
 }
 
-// SemanticCheck implemented as tree visitor
-// We visit only relevant nodes, i.e. VariableDeclaration and Identifier nodes
-// We keep a set of all names declared so far
-class SemanticCheck : public ParseTreeVisitor
+// Compiles the program through the cache in cacheDir
+// The whole source is read first, because the cache is keyed by its content hash
+// The cache is only filled from programs that printed no diagnostics at all,
+// so a warm run prints exactly what the cold run printed
+// Sets checked if the returned tree passed the semantic check
+ParseTree* compileCached(istream *in, const string& cacheDir, bool reportStats, WorkStealingPool *pool,
+                         bool fused, bool& checked)
 {
-    bool hasErrors;
+    stringstream source;
+    source << in->rdbuf();
+    string text = source.str();
 
-public:
-    SemanticCheck()
-            : hasErrors(false)
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    ProgramCache cache(cacheDir);
+    ParseTree *tree;
     {
+        PhaseTimer timer(PHASE_LOAD);
+        tree = cache.load(text);
     }
-
-    // After full traversal, we can use this function to see if there were any semantic errors
-    bool isErrorFree()
+    bool hit = tree != 0;
+    checked = hit;
+    if (!hit)
     {
-        return !hasErrors;
-    }
-
-    // Semantic rule #4 - check if variable wasn't declared before
-    virtual bool beginVisit(const VariableDeclaration *varDecl)
-    {
-        Identifier *identifier = varDecl->getIdentifier();
-        if (typeTable.find(identifier->getName()) != typeTable.end())
+        istringstream program(text);
+        tree = compile(&program, pool, fused, checked);
+        if (checked && errorCount == 0)
         {
-            // variable was declared before
-            error(varDecl->getLineNumber(), "variable " + identifier->getName() + " was already declared");
-            hasErrors = true;
+            cache.store(text, tree);
         }
-        else
-        {
-            typeTable[identifier->getName()] = varDecl->GetType();
-        }
-        // We return false here, because we don't want to go into VariableDeclaration children,
-        // as it only has one, Identifier, and we already handled that above
-        return false;
     }
-
-    virtual bool beginVisit(const VariableAssignment *varAssign)
+    if (reportStats)
     {
-        varAssign->getIdentifier()->accept(this);
-        varAssign->getLeft()->accept(this);
-        if (typeTable.find(varAssign->getIdentifier()->getName()) != typeTable.end() &&
-            varAssign->getLeft()->GetType() != typeTable[varAssign->getIdentifier()->getName()])
-        {
-            error(varAssign->getLeft()->getLineNumber(), "type error");
-            hasErrors = true;
-        }
-        return false;
+        chrono::microseconds elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+        cerr << "cache " << (hit ? "hit (warm start): loaded in " : "miss (cold start): compiled in ")
+             << elapsed.count() << " us" << endl;
     }
+    return tree;
+}
 
-    virtual bool beginVisit(const PrintCommand *printCmd)
+// How a prelude ended, see runPrelude()
+enum PreludeResult { PRELUDE_DONE, PRELUDE_REJECTED, PRELUDE_STOPPED };
+
+// Runs the prelude in path on theContext, or restores the state it leaves from
+// the snapshot at snapshotPath if one was taken of the same source, and takes
+// the snapshot if not and the prelude printed no diagnostics
+// Returns PRELUDE_REJECTED if it can't be read or has syntax or semantic
+// errors, and PRELUDE_STOPPED if a runtime error stopped it, after printing them
+static PreludeResult runPrelude(const string& path, const char *snapshotPath, bool reportStats)
+{
+    ifstream file(path);
+    if (file.fail())
     {
-        printCmd->getLeft()->accept(this);
-        return false;
+        cout << path << " FILE NOT FOUND" << endl;
+        return PRELUDE_REJECTED;
     }
+    stringstream source;
+    source << file.rdbuf();
+    string text = source.str();
 
-    // Semantic rule #2 - check if variable name was declared before use
-    // All identifiers that are not children of VariableDeclaration node
-    // must be uses of variable name, in expressions, assignments, etc.
-    virtual bool beginVisit(const Identifier *identifier)
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    uint64_t hash = hashSource(text.data(), text.size());
+    // a snapshot whose values are over the limits is a miss, so the prelude runs and stops where it would
+    bool hit = snapshotPath != 0 && loadSnapshot(snapshotPath, hash, *theOutput, theGovernor);
+    PreludeResult result = PRELUDE_DONE;
+    if (hit && theGovernor != 0)
     {
-        // we simply check if variable wasn't declared, if it was then it's name is in the set
-        if (typeTable.find(identifier->getName()) == typeTable.end())
+        // the strings the snapshot restored count against --max-strings as if the prelude set them
+        for (SymbolTable::const_iterator it = theContext->symbolTable.begin(); it != theContext->symbolTable.end(); ++it)
         {
-            // wasn't declared
-            error(identifier->getLineNumber(), "variable " + identifier->getName() + " is used before being declared");
-            hasErrors = true;
+            theGovernor->assign(0, it->second.stringValue.size());
         }
-        return false;
-    }
-
-    virtual bool beginVisit(const Addition *add)
-    {
-        return beginVisitOperation(add);
     }
-
-    virtual bool beginVisit(const Subtraction *sub)
+    if (!hit)
     {
-        return beginVisitOperation(sub);
+        // what the prelude prints is kept for the snapshot, then printed
+        ostringstream output;
+        ostream *printed = theOutput;
+        const string *fileName = theContext->inputFileName;
+        theOutput = &output;
+        theContext->inputFileName = &path;
+        istringstream program(text);
+        ParseTree *tree = Prog(&program);
+        if (hasParseErrors || (tree != 0 && !check(tree)))
+        {
+            result = PRELUDE_REJECTED;
+        }
+        else if (tree != 0)
+        {
+            if (theGovernor != 0)
+            {
+                theGovernor->startClock();
+            }
+            if (tree->Evaluate().type != EMPTY_TYPE)
+            {
+                result = PRELUDE_STOPPED;
+            }
+            if (theGovernor != 0)
+            {
+                theGovernor->stopClock();
+            }
+        }
+        theOutput = printed;
+        theContext->inputFileName = fileName;
+        *theOutput << output.str();
+        if (snapshotPath != 0 && result == PRELUDE_DONE && errorCount == 0 &&
+            !saveSnapshot(snapshotPath, hash, output.str()))
+        {
+            cerr << snapshotPath << " CANNOT WRITE SNAPSHOT" << endl;
+        }
+        // the program starts on its own first line
+        lineNumber = 0;
     }
-
-    virtual bool beginVisit(const Multiplication *mul)
+    if (reportStats && snapshotPath != 0)
     {
-        return beginVisitOperation(mul);
+        chrono::microseconds elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+        cerr << "snapshot " << (hit ? "hit (warm start): restored in " : "miss (cold start): prelude ran in ")
+             << elapsed.count() << " us" << endl;
     }
+    return result;
+}
 
-    virtual bool beginVisit(const Division *dvsn)
+// Gives standard output its own buffer back and prints the statistics of the run,
+// on stderr or as JSON into statsFile
+static void reportRunStats(RunStats& stats, CountingBuffer& printed, std::streambuf *stdoutBuffer, const char *statsFile)
+{
+    theStats = 0;
+    cout.flush();
+    cout.rdbuf(stdoutBuffer);
+    stats.bytesPrinted = printed.bytes();
+    stats.declared = theContext->typeTable.size();
+    stats.variables = theContext->symbolTable.size();
+    stats.interned = theInterner->size();
+    if (statsFile == 0)
     {
-        return beginVisitOperation(dvsn);
+        stats.print(cerr);
+        return;
     }
-
-    bool beginVisitOperation(const ParseTree *op)
+    ofstream json(statsFile);
+    stats.printJson(json);
+    if (json.fail())
     {
-        op->getLeft()->accept(this);
-        op->getRight()->accept(this);
-        if (op->GetType() == ERROR_TYPE)
-        {
-            error(op->getLineNumber(), "type error");
-        }
-        return false;
+        cerr << statsFile << " CANNOT WRITE STATISTICS" << endl;
     }
-};
+}
 
 int main(int argc, char *argv[])
 {
+    bool reportCacheStats = false;
+    bool syncStdin = false;
+    bool deadStores = false;
+    bool reportDeadStores = false;
+    bool fusedCheck = false;
+    bool shareNodes = false;
+    bool reportSharing = false;
+    bool reportStats = false;
+    const char *statsFile = 0;
+    bool reportMemory = false;
+    bool perfCounters = false;
+    bool profileLines = false;
+    size_t profileTop = 20;
+    const char *profileStacks = 0;
+    unsigned threads = 1;
+    unsigned long forkThreshold = DEFAULT_FORK_THRESHOLD;
+    ResourceLimits limits;
+    const char *rowsFile = 0;
+    const char *preludeFile = 0;
+    const char *snapshotFile = 0;
     int arg = 1;
     // Check for arguments
+    // --cache-stats reports cold versus warm startup time on stderr, also of a snapshot
+    // --sync-stdin reads standard input through cin instead of the read-ahead thread
+    // --dse removes dead stores and unused declarations before evaluation,
+    // --dse-report also prints what was removed on stderr
+    // --fused-check checks the program while parsing it instead of in a pass of its own
+    // --share builds identical subexpressions once and reuses the values of constant ones,
+    // --share-report also prints the memory and time that saved on stderr
+    // --stats prints the time of every phase, and token, node, symbol and output counts on stderr,
+    // --stats-json file writes them to file as JSON instead
+    // --memory accounts for every allocation and prints the memory of every phase and kind of node on stderr
+    // --perf prints hardware counts of every phase on stderr, where the system allows perf_event_open
+    // --profile prints the lines that took the most evaluation time on stderr, --profile-top n
+    // how many of them, and --profile-stacks file writes collapsed call stacks of lines to file
+    // -j n evaluates independent statements and large operands on n threads
+    // --fork-threshold n sets the operand cost from which operands are evaluated in parallel
+    // --max-value n, --max-strings n and --time-limit ms limit the size of any value, the total
+    // size of the strings and the time of evaluation, see governor.h
+    // --rows file evaluates the program once for every row of file, a CSV file or a binary column
+    // file binding declared variables, see batch.h; -j, --dse, --profile and limits don't apply to it
+    // --prelude file runs file first, and the program on the variables it leaves; --snapshot file
+    // restores them from file instead if it was taken of the same prelude, and takes it if not,
+    // see snapshot.h
     // filename for input file, if any
     while (arg < argc)
     {
         string curArg = argv[arg];
-        if (theInputFileName == 0)
+        if (curArg == "--cache-stats")
+        {
+            reportCacheStats = true;
+        }
+        else if (curArg == "--sync-stdin")
+        {
+            syncStdin = true;
+        }
+        else if (curArg == "--fused-check")
+        {
+            fusedCheck = true;
+        }
+        else if (curArg == "--share" || curArg == "--share-report")
+        {
+            shareNodes = true;
+            reportSharing = reportSharing || curArg == "--share-report";
+        }
+        else if (curArg == "--stats")
+        {
+            reportStats = true;
+        }
+        else if (curArg == "--stats-json" && arg + 1 < argc)
+        {
+            reportStats = true;
+            statsFile = argv[++arg];
+        }
+        else if (curArg == "--memory")
+        {
+            reportMemory = true;
+        }
+        else if (curArg == "--perf")
+        {
+            perfCounters = true;
+        }
+        else if (curArg == "--profile")
+        {
+            profileLines = true;
+        }
+        else if (curArg == "--profile-top" && arg + 1 < argc)
+        {
+            profileLines = true;
+            profileTop = strtoul(argv[++arg], 0, 10);
+        }
+        else if (curArg == "--profile-stacks" && arg + 1 < argc)
+        {
+            profileLines = true;
+            profileStacks = argv[++arg];
+        }
+        else if (curArg == "-j" && arg + 1 < argc)
+        {
+            threads = atoi(argv[++arg]);
+        }
+        else if (curArg == "--fork-threshold" && arg + 1 < argc)
+        {
+            forkThreshold = strtoul(argv[++arg], 0, 10);
+        }
+        else if (curArg == "--max-value" && arg + 1 < argc)
+        {
+            limits.maxValueBytes = strtoull(argv[++arg], 0, 10);
+        }
+        else if (curArg == "--max-strings" && arg + 1 < argc)
+        {
+            limits.maxStringBytes = strtoull(argv[++arg], 0, 10);
+        }
+        else if (curArg == "--time-limit" && arg + 1 < argc)
+        {
+            limits.timeLimit = chrono::milliseconds(strtoull(argv[++arg], 0, 10));
+        }
+        else if (curArg == "--rows" && arg + 1 < argc)
+        {
+            rowsFile = argv[++arg];
+        }
+        else if (curArg == "--prelude" && arg + 1 < argc)
+        {
+            preludeFile = argv[++arg];
+        }
+        else if (curArg == "--snapshot" && arg + 1 < argc)
+        {
+            snapshotFile = argv[++arg];
+        }
+        else if (curArg == "--dse" || curArg == "--dse-report")
+        {
+            deadStores = true;
+            reportDeadStores = reportDeadStores || curArg == "--dse-report";
+        }
+        else if (theInputFileName == 0)
         {
             theInputFileName = new string(curArg);
         }
@@ -151,39 +342,248 @@ int main(int argc, char *argv[])
         ++arg;
     }
 
-    ParseTree *tree = 0;
-    // Read from standard input if no file name was provided
-    if (theInputFileName == 0)
+    MemoryReport memory;
+    if (reportMemory)
     {
-        tree = Prog( &cin );
+        enableMemoryAccounting();
+        theMemoryReport = &memory;
     }
-    else
+
+    // Compiled programs are cached only if PARSER_CACHE_DIR names the cache directory
+    const char *cacheDir = getenv("PARSER_CACHE_DIR");
+
+    istream *in = &cin;
+    ifstream f;
+    // Standard input is usually a pipe, which can't be mapped and is slow to read a
+    // character at a time, so a reader thread fills large buffers ahead of the lexer
+    AsyncInput *stdinBuffer = 0;
+    istream asyncStdin(0);
+    // Read from file if name was provided, from standard input otherwise
+    if (theInputFileName == 0 && !syncStdin)
+    {
+        stdinBuffer = new AsyncInput(0);
+        asyncStdin.rdbuf(stdinBuffer);
+        in = &asyncStdin;
+    }
+    else if (theInputFileName != 0)
     {
-        // Read from file if name was provided
-        ifstream f;
         f.open(*theInputFileName);
         if (f.fail())
         {
             cout << *theInputFileName << " FILE NOT FOUND" << endl;
             return 1;
         }
-        tree = Prog (&f);
-        f.close();
+        in = &f;
+    }
+
+    theContext->inputFileName = theInputFileName;
+
+    // the rows bind variables the program declares, which a prelude's variables are not
+    if (rowsFile != 0 && preludeFile != 0)
+    {
+        cout << "--rows AND --prelude CANNOT BE COMBINED" << endl;
+        return 1;
+    }
+    // rows are evaluated together a statement at a time, so none has a clock or strings of its own
+    if (rowsFile != 0 && limits.any())
+    {
+        cout << "--rows AND RESOURCE LIMITS CANNOT BE COMBINED" << endl;
+        return 1;
+    }
+
+    std::unique_ptr<RowInput> rows;
+    if (rowsFile != 0)
+    {
+        string message;
+        rows.reset(openRowInput(rowsFile, message));
+        if (!rows)
+        {
+            cout << message << endl;
+            return 1;
+        }
+    }
+
+    // the counters are opened first, so the threads of the pool inherit them
+    std::unique_ptr<PerfReport> perf;
+    if (perfCounters)
+    {
+        perf.reset(new PerfReport());
+        thePerfReport = perf.get();
+    }
+
+    // -j shares one pool between checking and evaluation
+    std::unique_ptr<WorkStealingPool> pool;
+    if (threads > 1)
+    {
+        pool.reset(new WorkStealingPool(threads));
+    }
+
+    // --stats counts what goes through standard output
+    // --perf needs the token and node counts too
+    RunStats stats;
+    std::streambuf *stdoutBuffer = cout.rdbuf();
+    CountingBuffer printed(stdoutBuffer);
+    if (reportStats || perfCounters)
+    {
+        theStats = &stats;
+    }
+    if (reportStats)
+    {
+        cout.rdbuf(&printed);
+    }
+
+    NodeSharing sharing;
+    if (shareNodes)
+    {
+        theNodeSharing = &sharing;
+    }
+
+    // the limits cover the prelude and the program, as one run of both would be;
+    // the clock only runs while either is evaluated, not while they are read or parsed
+    std::unique_ptr<ResourceGovernor> governor;
+    if (limits.any())
+    {
+        governor.reset(new ResourceGovernor(limits));
+        governor->stopClock();
+        theGovernor = governor.get();
+    }
+
+    if (preludeFile != 0)
+    {
+        PreludeResult prelude = runPrelude(preludeFile, snapshotFile, reportCacheStats);
+        if (prelude != PRELUDE_DONE)
+        {
+            // a runtime error ends the run as it would end the prelude and the program in one
+            if (reportStats)
+            {
+                reportRunStats(stats, printed, stdoutBuffer, statsFile);
+            }
+            return prelude == PRELUDE_REJECTED ? 1 : 0;
+        }
+    }
+
+    ParseTree *tree = 0;
+    bool checked = false;
+    // a program checked against a prelude's variables isn't cached, its key doesn't cover them
+    if (cacheDir != 0 && *cacheDir != 0 && preludeFile == 0)
+    {
+        tree = compileCached(in, cacheDir, reportCacheStats, pool.get(), fusedCheck, checked);
+    }
+    else
+    {
+        tree = compile(in, pool.get(), fusedCheck, checked);
+    }
+    theNodeSharing = 0;
+    sharing.finish();
+    f.close();
+    delete stdinBuffer;
+    if (reportStats || perfCounters)
+    {
+        stats.countNodes(tree);
+    }
+    if (reportMemory)
+    {
+        memory.countNodes(tree);
     }
     if( tree == 0 || hasParseErrors)
     {
         // Parse finished and there were errors
         // They were printed in-the-fly, so we can finish here
+        if (reportMemory)
+        {
+            memory.print(cerr);
+        }
+        if (perf)
+        {
+            perf->print(cerr, stats);
+        }
+        if (reportStats)
+        {
+            reportRunStats(stats, printed, stdoutBuffer, statsFile);
+        }
         return 1;
     }
-    // Semantic check is performed by creating SemanticCheck object and accepting it by the tree
-    SemanticCheck semanticCheck;
-    tree->accept(&semanticCheck);
-    if (semanticCheck.isErrorFree())
+    if (checked && deadStores && !rows)
     {
-        tree->Evaluate();
+        DeadStoreReport report;
+        {
+            PhaseTimer timer(PHASE_DSE);
+            tree = eliminateDeadStores(tree, report, limits);
+        }
+        if (reportDeadStores)
+        {
+            cerr << "dead stores: removed " << report.removedAssignments << " set and "
+                 << report.removedDeclarations << " declaration statements, "
+                 << report.nodesSaved << " expression nodes no longer evaluated" << endl;
+        }
     }
-    return 0;
+    LineProfiler profiler;
+    int status = 0;
+    if (checked && tree != 0)
+    {
+        PhaseTimer timer(PHASE_EVALUATE);
+        if (governor)
+        {
+            governor->startClock();
+        }
+        if (rows)
+        {
+            status = evaluateRows(tree, *rows, cout) ? 0 : 1;
+        }
+        // the profiler follows one thread, so a profiled program is evaluated on this one
+        else if (profileLines)
+        {
+            theProfiler = &profiler;
+            tree->Evaluate();
+            theProfiler = 0;
+        }
+        else if (pool)
+        {
+            ForkJoinEvaluator forkJoin(*pool);
+            markForkPoints(tree, forkThreshold);
+            theOperandEvaluator = &forkJoin;
+            evaluateParallel(tree, *pool);
+            theOperandEvaluator = 0;
+        }
+        else
+        {
+            tree->Evaluate();
+        }
+        theGovernor = 0;
+    }
+    if (reportSharing)
+    {
+        ShareReport report = sharing.report();
+        cerr << "sharing: built " << report.nodesAllocated << " of " << report.nodesRequested
+             << " expression nodes, saved " << report.bytesSaved << " bytes less "
+             << report.lineTableBytes << " bytes of line tables; reused " << report.valueHits
+             << " constant values, saving an estimated " << chrono::duration_cast<chrono::microseconds>(report.timeSaved).count()
+             << " us of evaluation" << endl;
+    }
+    if (profileLines)
+    {
+        profiler.printTop(cerr, profileTop);
+        if (profileStacks != 0)
+        {
+            ofstream stacks(profileStacks);
+            profiler.printCollapsed(stacks);
+            if (stacks.fail())
+            {
+                cerr << profileStacks << " CANNOT WRITE PROFILE" << endl;
+            }
+        }
+    }
+    if (reportMemory)
+    {
+        memory.print(cerr);
+    }
+    if (perf)
+    {
+        perf->print(cerr, stats);
+    }
+    if (reportStats)
+    {
+        reportRunStats(stats, printed, stdoutBuffer, statsFile);
+    }
+    return status;
 }
-
-
@@ -0,0 +1,248 @@
+#include <malloc.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+#include "memory.h"
+
+const char * const memoryCategoryNames[MEM_CATEGORY_COUNT] = { "other", "tokens", "nodes", "tables", "values" };
+
+thread_local MemoryCategory theMemoryScope = MEM_CATEGORY_COUNT;
+
+MemoryUsage::MemoryUsage() : liveTotal(0), peakTotal(0)
+{
+    for (int category = 0; category < MEM_CATEGORY_COUNT; ++category)
+    {
+        live[category] = 0;
+        peak[category] = 0;
+    }
+}
+
+// The block table allocates straight from malloc, so it doesn't account for itself
+template <class T>
+struct MallocAllocator
+{
+    typedef T value_type;
+
+    MallocAllocator() {}
+    template <class U>
+    MallocAllocator(const MallocAllocator<U>&) {}
+
+    T* allocate(size_t n)
+    {
+        void *block = malloc(n * sizeof(T));
+        if (block == 0)
+        {
+            throw std::bad_alloc();
+        }
+        return (T*)block;
+    }
+    void deallocate(T *block, size_t) { free(block); }
+
+    template <class U>
+    bool operator==(const MallocAllocator<U>&) const { return true; }
+    template <class U>
+    bool operator!=(const MallocAllocator<U>&) const { return false; }
+};
+
+typedef std::unordered_map<void*, unsigned char, std::hash<void*>, std::equal_to<void*>,
+                           MallocAllocator<std::pair<void* const, unsigned char> > > BlockTable;
+
+// All of this is constant-initialized, so it works for allocations made before main
+static std::atomic<bool> accounting(false);
+static std::atomic<int> phaseCategory(MEM_OTHER);
+static std::mutex accountingLock;
+static BlockTable *blocks = 0;
+// since accounting started, and since the current phase started
+static MemoryUsage *total = 0;
+static MemoryUsage *phase = 0;
+
+// A library that replaced operator new would replace it for the whole process
+// it is loaded into, so it leaves the operators and what they charge out
+#ifndef NO_MEMORY_ACCOUNTING
+
+static void charge(void *block)
+{
+    MemoryCategory category = theMemoryScope != MEM_CATEGORY_COUNT ? theMemoryScope : (MemoryCategory)phaseCategory.load();
+    long size = malloc_usable_size(block);
+    std::lock_guard<std::mutex> guard(accountingLock);
+    (*blocks)[block] = (unsigned char)category;
+    MemoryUsage *usages[] = { total, phase };
+    for (MemoryUsage *usage : usages)
+    {
+        usage->live[category] += size;
+        usage->liveTotal += size;
+        if (usage->live[category] > usage->peak[category])
+        {
+            usage->peak[category] = usage->live[category];
+        }
+        if (usage->liveTotal > usage->peakTotal)
+        {
+            usage->peakTotal = usage->liveTotal;
+        }
+    }
+}
+
+static void release(void *block)
+{
+    long size = malloc_usable_size(block);
+    std::lock_guard<std::mutex> guard(accountingLock);
+    BlockTable::iterator it = blocks->find(block);
+    if (it == blocks->end())
+    {
+        return;
+    }
+    MemoryCategory category = (MemoryCategory)it->second;
+    blocks->erase(it);
+    total->live[category] -= size;
+    total->liveTotal -= size;
+    phase->live[category] -= size;
+    phase->liveTotal -= size;
+}
+
+#endif
+
+void enableMemoryAccounting()
+{
+    std::lock_guard<std::mutex> guard(accountingLock);
+    if (accounting.load())
+    {
+        return;
+    }
+    blocks = new (malloc(sizeof(BlockTable))) BlockTable();
+    total = new (malloc(sizeof(MemoryUsage))) MemoryUsage();
+    phase = new (malloc(sizeof(MemoryUsage))) MemoryUsage();
+    accounting.store(true);
+}
+
+bool memoryAccountingEnabled()
+{
+    return accounting.load(std::memory_order_relaxed);
+}
+
+void beginMemoryPhase(MemoryCategory defaultCategory)
+{
+    std::lock_guard<std::mutex> guard(accountingLock);
+    phaseCategory.store(defaultCategory);
+    *phase = *total;
+    for (int category = 0; category < MEM_CATEGORY_COUNT; ++category)
+    {
+        phase->peak[category] = phase->live[category];
+    }
+    phase->peakTotal = phase->liveTotal;
+}
+
+MemoryUsage endMemoryPhase()
+{
+    std::lock_guard<std::mutex> guard(accountingLock);
+    phaseCategory.store(MEM_OTHER);
+    return *phase;
+}
+
+MemoryUsage memoryUsage()
+{
+    std::lock_guard<std::mutex> guard(accountingLock);
+    return *total;
+}
+
+#ifndef NO_MEMORY_ACCOUNTING
+
+static void* allocate(size_t size)
+{
+    for (;;)
+    {
+        void *block = malloc(size == 0 ? 1 : size);
+        if (block != 0)
+        {
+            if (accounting.load(std::memory_order_relaxed))
+            {
+                charge(block);
+            }
+            return block;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (handler == 0)
+        {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+static void deallocate(void *block)
+{
+    if (block != 0 && accounting.load(std::memory_order_relaxed))
+    {
+        release(block);
+    }
+    free(block);
+}
+
+void* operator new(size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new[](size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return 0;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return 0;
+    }
+}
+
+void operator delete(void *block) noexcept
+{
+    deallocate(block);
+}
+
+void operator delete[](void *block) noexcept
+{
+    deallocate(block);
+}
+
+void operator delete(void *block, size_t) noexcept
+{
+    deallocate(block);
+}
+
+void operator delete[](void *block, size_t) noexcept
+{
+    deallocate(block);
+}
+
+void operator delete(void *block, const std::nothrow_t&) noexcept
+{
+    deallocate(block);
+}
+
+void operator delete[](void *block, const std::nothrow_t&) noexcept
+{
+    deallocate(block);
+}
+
+#endif
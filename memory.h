@@ -0,0 +1,81 @@
+#ifndef MEMORY_H_
+#define MEMORY_H_
+
+#include <ostream>
+#include <memory>
+
+// Memory accounting for --memory
+//
+// memory.cpp replaces the global operator new and delete. Once accounting is
+// enabled, every allocation is charged to a category and every block is
+// remembered with its category and the size malloc really gave it, so live and
+// peak bytes are exact; blocks allocated before it was enabled are ignored.
+// Until then the operators only test a flag on their way to malloc and free.
+// Built with -DNO_MEMORY_ACCOUNTING, as the embeddable library is, memory.cpp
+// leaves the operators alone and nothing is accounted.
+//
+// An allocation belongs to the category of the innermost MemoryScope of its
+// thread, or else to the default category of the phase being run.
+
+enum MemoryCategory { MEM_OTHER, MEM_TOKENS, MEM_NODES, MEM_TABLES, MEM_VALUES, MEM_CATEGORY_COUNT };
+
+extern const char * const memoryCategoryNames[MEM_CATEGORY_COUNT];
+
+// innermost scope of this thread, or MEM_CATEGORY_COUNT outside of any
+extern thread_local MemoryCategory theMemoryScope;
+
+// Charges the allocations of this thread to a category while it lasts
+class MemoryScope
+{
+    MemoryCategory saved;
+
+public:
+    explicit MemoryScope(MemoryCategory category) : saved(theMemoryScope) { theMemoryScope = category; }
+    ~MemoryScope() { theMemoryScope = saved; }
+};
+
+// Standard allocator that charges what it allocates to category
+template <class T, MemoryCategory category>
+struct CategoryAllocator : public std::allocator<T>
+{
+    template <class U>
+    struct rebind
+    {
+        typedef CategoryAllocator<U, category> other;
+    };
+
+    CategoryAllocator() {}
+    template <class U>
+    CategoryAllocator(const CategoryAllocator<U, category>&) {}
+
+    T* allocate(size_t n)
+    {
+        MemoryScope scope(category);
+        return std::allocator<T>::allocate(n);
+    }
+};
+
+struct MemoryUsage
+{
+    long live[MEM_CATEGORY_COUNT];
+    long peak[MEM_CATEGORY_COUNT];
+    long liveTotal;
+    long peakTotal;
+
+    MemoryUsage();
+};
+
+// Starts accounting; from now on it never stops
+extern void enableMemoryAccounting();
+extern bool memoryAccountingEnabled();
+
+// Marks the start and end of a phase (see PhaseTimer): the peaks of the phase
+// start from what is live at its start
+// Allocations outside of any scope default to defaultCategory until the end
+extern void beginMemoryPhase(MemoryCategory defaultCategory);
+extern MemoryUsage endMemoryPhase();
+
+// what is live now, and the peaks since accounting started
+extern MemoryUsage memoryUsage();
+
+#endif /* MEMORY_H_ */
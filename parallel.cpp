@@ -0,0 +1,282 @@
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <vector>
+using std::set;
+using std::vector;
+
+#include "parallel.h"
+
+// Collects the names an expression reads, and whether evaluating it may fail
+class UseCollector : public ParseTreeVisitor
+{
+    bool beginVisitStringOperation(const ParseTree *op)
+    {
+        if (op->GetCheckedType() == STRING_TYPE)
+        {
+            mayFail = true;
+        }
+        return true;
+    }
+
+public:
+    set<Atom> uses;
+    // an integer division by anything but a nonzero constant, or a string + or *,
+    // which the governor may stop or which may run out of memory
+    bool mayFail;
+
+    UseCollector() : mayFail(false) {}
+
+    virtual bool beginVisit(const Identifier *identifier)
+    {
+        uses.insert(identifier->getAtom());
+        return false;
+    }
+
+    virtual bool beginVisit(const Division *dvsn)
+    {
+        const ParseTree *divisor = dvsn->getRight();
+        if (dvsn->GetCheckedType() == INT_TYPE &&
+            (dynamic_cast<const IntegerConstant*>(divisor) == 0 || divisor->GetIntValue() == 0))
+        {
+            mayFail = true;
+        }
+        return true;
+    }
+
+    virtual bool beginVisit(const Addition *add)
+    {
+        return beginVisitStringOperation(add);
+    }
+
+    virtual bool beginVisit(const Multiplication *mul)
+    {
+        return beginVisitStringOperation(mul);
+    }
+};
+
+struct StatementTask
+{
+    const ParseTree	*stmt;
+    vector<size_t>	successors;
+    // number of statements this one still waits for
+    int				pending;
+    // whether evaluating the statement may stop the program
+    bool			mayFail;
+    bool			done;
+    bool			failed;
+    // everything the statement printed, written out when its turn comes
+    string			output;
+    // what the statement threw, thrown again on the calling thread when its turn comes
+    std::exception_ptr	exception;
+
+    StatementTask() : stmt(0), pending(0), mayFail(false), done(false), failed(false) {}
+};
+
+class Scheduler
+{
+    vector<StatementTask>	tasks;
+    WorkStealingPool&		pool;
+    Context					*context;
+    OperandEvaluator		*evaluator;
+    ResourceGovernor		*governor;
+    std::mutex				lock;
+    std::condition_variable	changed;
+    // statements whose dependencies are done, held back while a statement before
+    // them that may fail hasn't finished, so nothing runs past a failure
+    set<size_t>				ready;
+    // the first statement that may fail and hasn't finished, or failed; statements
+    // before a failed one still run, since the program stops only after them
+    size_t					firstRisky;
+
+    // Orders every statement after the last write of each variable it reads
+    // or writes, and a write after every read since the previous write
+    void analyze(const ParseTree *program)
+    {
+        for (const ParseTree *list = program; list != 0; list = list->getRight())
+        {
+            tasks.push_back(StatementTask());
+            tasks.back().stmt = list->getLeft();
+        }
+
+        // with a time limit, every set and print may stop the program
+        bool timed = governor != 0 && governor->getLimits().timeLimit.count() != 0;
+        map<Atom, size_t> lastWriter;
+        map<Atom, vector<size_t> > readers;
+        for (size_t i = 0; i < tasks.size(); ++i)
+        {
+            const ParseTree *stmt = tasks[i].stmt;
+            UseCollector collector;
+            Atom written = NO_ATOM;
+            if (const VariableDeclaration *varDecl = dynamic_cast<const VariableDeclaration*>(stmt))
+            {
+                written = varDecl->getIdentifier()->getAtom();
+                // created up front, so statements running at once never insert into symbolTable
+                context->variable(written);
+            }
+            else
+            {
+                stmt->getLeft()->accept(&collector);
+                if (const VariableAssignment *varAssign = dynamic_cast<const VariableAssignment*>(stmt))
+                {
+                    written = varAssign->getIdentifier()->getAtom();
+                }
+                tasks[i].mayFail = collector.mayFail || timed;
+            }
+
+            set<size_t> dependencies;
+            for (set<Atom>::iterator it = collector.uses.begin(); it != collector.uses.end(); ++it)
+            {
+                map<Atom, size_t>::iterator writer = lastWriter.find(*it);
+                if (writer != lastWriter.end())
+                {
+                    dependencies.insert(writer->second);
+                }
+                readers[*it].push_back(i);
+            }
+            if (written != NO_ATOM)
+            {
+                map<Atom, size_t>::iterator writer = lastWriter.find(written);
+                if (writer != lastWriter.end())
+                {
+                    dependencies.insert(writer->second);
+                }
+                vector<size_t>& previousReaders = readers[written];
+                for (size_t r = 0; r < previousReaders.size(); ++r)
+                {
+                    if (previousReaders[r] != i)
+                    {
+                        dependencies.insert(previousReaders[r]);
+                    }
+                }
+                previousReaders.clear();
+                lastWriter[written] = i;
+            }
+
+            for (set<size_t>::iterator it = dependencies.begin(); it != dependencies.end(); ++it)
+            {
+                tasks[*it].successors.push_back(i);
+            }
+            tasks[i].pending = dependencies.size();
+        }
+    }
+
+    // must be called with lock held
+    void start(size_t i)
+    {
+        pool.submit([this, i]() { run(i); });
+    }
+
+    // Starts the ready statements that no unfinished statement before them may stop;
+    // a statement that may fail itself starts once those before it that may fail are done
+    // must be called with lock held
+    void release()
+    {
+        while (firstRisky < tasks.size() && (!tasks[firstRisky].mayFail || (tasks[firstRisky].done && !tasks[firstRisky].failed)))
+        {
+            ++firstRisky;
+        }
+        while (!ready.empty() && *ready.begin() <= firstRisky)
+        {
+            size_t i = *ready.begin();
+            ready.erase(ready.begin());
+            start(i);
+        }
+    }
+
+    void run(size_t i)
+    {
+        StatementTask& task = tasks[i];
+        std::ostringstream output;
+        // a worker joining a forked operand may run this nested in another statement
+        Context *savedContext = theContext;
+        ostream *savedOutput = theOutput;
+        OperandEvaluator *savedEvaluator = theOperandEvaluator;
+        ResourceGovernor *savedGovernor = theGovernor;
+        theContext = context;
+        theOutput = &output;
+        theOperandEvaluator = evaluator;
+        theGovernor = governor;
+        bool failed = true;
+        std::exception_ptr exception;
+        try
+        {
+            failed = task.stmt->Evaluate().type != EMPTY_TYPE;
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+        theContext = savedContext;
+        theOutput = savedOutput;
+        theOperandEvaluator = savedEvaluator;
+        theGovernor = savedGovernor;
+
+        std::lock_guard<std::mutex> guard(lock);
+        task.output = output.str();
+        task.failed = failed;
+        task.exception = exception;
+        task.done = true;
+        for (size_t s = 0; s < task.successors.size(); ++s)
+        {
+            if (--tasks[task.successors[s]].pending == 0)
+            {
+                ready.insert(task.successors[s]);
+            }
+        }
+        release();
+        changed.notify_all();
+    }
+
+public:
+    Scheduler(WorkStealingPool& pool, Context *context, OperandEvaluator *evaluator, ResourceGovernor *governor)
+            : pool(pool), context(context), evaluator(evaluator), governor(governor), firstRisky(0)
+    {
+    }
+
+    Value evaluate(const ParseTree *program)
+    {
+        analyze(program);
+
+        std::unique_lock<std::mutex> guard(lock);
+        for (size_t i = 0; i < tasks.size(); ++i)
+        {
+            if (tasks[i].pending == 0)
+            {
+                ready.insert(i);
+            }
+        }
+        release();
+
+        bool failed = false;
+        std::exception_ptr exception;
+        for (size_t i = 0; i < tasks.size() && !failed; ++i)
+        {
+            StatementTask& task = tasks[i];
+            while (!task.done)
+            {
+                changed.wait(guard);
+            }
+            *theOutput << task.output;
+            string().swap(task.output);
+            failed = task.failed;
+            exception = task.exception;
+        }
+
+        // every statement before the failed one is done, and none after it was started
+        if (exception)
+        {
+            theOutput->flush();
+            std::rethrow_exception(exception);
+        }
+        return failed ? Value::Error() : Value::Empty();
+    }
+};
+
+Value evaluateParallel(const ParseTree *program, WorkStealingPool& pool)
+{
+    Scheduler scheduler(pool, theContext, theOperandEvaluator, theGovernor);
+    return scheduler.evaluate(program);
+}
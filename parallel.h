@@ -0,0 +1,26 @@
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include "parser.h"
+#include "workstealing.h"
+
+// Dependency-aware parallel evaluation of a statement list
+//
+// A def-use analysis over the variables each statement reads and writes orders
+// every statement after the statements it depends on (read after write, write
+// after write and write after read). Statements whose dependencies are done
+// run concurrently on the pool, each printing into its own buffer, and the
+// calling thread writes the buffers out in program order. A statement that may
+// fail (an integer division by a variable, a string + or *, or any set or
+// print under a time limit) holds back every statement after it until it is
+// done, so the first statement that fails stops the program exactly where
+// StatementList::Evaluate() would, and nothing after it runs. An exception
+// a statement throws is thrown again on the calling thread in its turn.
+//
+// Statements run with the OperandEvaluator of the calling thread, so large
+// expressions inside them may fork as well (see forkjoin.h).
+//
+// Returns what StatementList::Evaluate() would return for the program.
+extern Value evaluateParallel(const ParseTree *program, WorkStealingPool& pool);
+
+#endif /* PARALLEL_H_ */
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <vector>
+using std::vector;
+
+#include "parallelcheck.h"
+#include "semantic.h"
+
+// fewer statements per chunk aren't worth a task of their own
+static const size_t MIN_CHUNK_STATEMENTS = 4096;
+
+struct Declaration
+{
+    TypeForNode	type;
+    // index of the statement that first declares the name
+    size_t		statement;
+};
+
+typedef std::unordered_map<Atom, Declaration> DeclarationTable;
+
+// The outcome of checking one chunk of statements
+struct CheckedChunk
+{
+    size_t		begin;
+    size_t		end;
+    string		output;
+    int			errors;
+    bool		errorFree;
+
+    CheckedChunk() : begin(0), end(0), errors(0), errorFree(true) {}
+};
+
+// SemanticCheck for a chunk of statements, with the declarations coming from
+// the table of the first phase instead of those seen so far
+class ChunkCheck : public SemanticCheck
+{
+    const DeclarationTable&		declarations;
+    size_t					statement;
+
+public:
+    explicit ChunkCheck(const DeclarationTable& declarations)
+            : declarations(declarations), statement(0)
+    {
+    }
+
+    void setStatement(size_t index) { statement = index; }
+
+    virtual void checkDeclaration(const VariableDeclaration *varDecl)
+    {
+        Atom name = varDecl->getIdentifier()->getAtom();
+        if (declarations.find(name)->second.statement != statement)
+        {
+            report(varDecl->getLineNumber(), "variable " + varDecl->getIdentifier()->getName() + " was already declared");
+            setError();
+        }
+        else
+        {
+            theContext->typeTable[name] = varDecl->GetType();
+        }
+    }
+};
+
+static void checkChunk(const vector<const ParseTree*>& statements, const DeclarationTable& declarations,
+                       const string *inputFileName, CheckedChunk& chunk)
+{
+    // the types of the names declared before the chunk starts
+    Context context;
+    context.inputFileName = inputFileName;
+    for (DeclarationTable::const_iterator it = declarations.begin(); it != declarations.end(); ++it)
+    {
+        if (it->second.statement < chunk.begin)
+        {
+            context.typeTable.insert(std::make_pair(it->first, it->second.type));
+        }
+    }
+
+    std::ostringstream output;
+    Context *savedContext = theContext;
+    ostream *savedOutput = theOutput;
+    int savedErrorCount = errorCount;
+    theContext = &context;
+    theOutput = &output;
+    errorCount = 0;
+
+    ChunkCheck chunkCheck(declarations);
+    for (size_t i = chunk.begin; i < chunk.end; ++i)
+    {
+        chunkCheck.setStatement(i);
+        statements[i]->accept(&chunkCheck);
+    }
+    chunk.output = output.str();
+    chunk.errors = errorCount;
+    chunk.errorFree = chunkCheck.isErrorFree();
+
+    theContext = savedContext;
+    theOutput = savedOutput;
+    errorCount = savedErrorCount;
+}
+
+bool checkParallel(const ParseTree *program, WorkStealingPool& pool)
+{
+    vector<const ParseTree*> statements;
+    for (const ParseTree *list = program; list != 0; list = list->getRight())
+    {
+        statements.push_back(list->getLeft());
+    }
+    size_t chunkSize = std::max(MIN_CHUNK_STATEMENTS, statements.size() / (4 * pool.size()) + 1);
+    if (statements.size() < 2 * chunkSize)
+    {
+        return check(program);
+    }
+
+    // Phase one: the first declaration of every name
+    DeclarationTable declarations;
+    for (size_t i = 0; i < statements.size(); ++i)
+    {
+        if (const VariableDeclaration *varDecl = dynamic_cast<const VariableDeclaration*>(statements[i]))
+        {
+            Declaration declaration;
+            declaration.type = varDecl->GetType();
+            declaration.statement = i;
+            declarations.insert(std::make_pair(varDecl->getIdentifier()->getAtom(), declaration));
+        }
+    }
+
+    // Phase two: the chunks, in parallel
+    vector<CheckedChunk> chunks((statements.size() + chunkSize - 1) / chunkSize);
+    vector<std::unique_ptr<WorkStealingPool::Task> > tasks;
+    const string *inputFileName = theContext->inputFileName;
+    for (size_t c = 0; c < chunks.size(); ++c)
+    {
+        CheckedChunk& chunk = chunks[c];
+        chunk.begin = c * chunkSize;
+        chunk.end = std::min(statements.size(), chunk.begin + chunkSize);
+        tasks.push_back(std::unique_ptr<WorkStealingPool::Task>(new WorkStealingPool::Task(
+                [&statements, &declarations, inputFileName, &chunk]()
+                {
+                    checkChunk(statements, declarations, inputFileName, chunk);
+                })));
+        pool.fork(*tasks.back());
+    }
+
+    bool errorFree = true;
+    for (size_t c = 0; c < chunks.size(); ++c)
+    {
+        pool.join(*tasks[c]);
+        *theOutput << chunks[c].output;
+        errorCount += chunks[c].errors;
+        errorFree = errorFree && chunks[c].errorFree;
+    }
+
+    for (DeclarationTable::iterator it = declarations.begin(); it != declarations.end(); ++it)
+    {
+        theContext->typeTable[it->first] = it->second.type;
+    }
+    return errorFree;
+}
@@ -0,0 +1,24 @@
+#ifndef PARALLELCHECK_H_
+#define PARALLELCHECK_H_
+
+#include "parser.h"
+#include "workstealing.h"
+
+// Two-phase semantic check for large programs
+//
+// The first phase scans the statement list once, sequentially, for
+// declarations and builds an immutable table of every name with its type and
+// the statement that first declares it. The second phase checks chunks of
+// consecutive statements on the pool: within a chunk, a name is declared once
+// the statement that first declares it has been passed, just as it is for the
+// sequential SemanticCheck, and a later declaration of it is a duplicate.
+// Every chunk prints into its own buffer, and the buffers are written in
+// program order, so the messages are exactly those of check().
+//
+// Programs too short to split are checked by check() on the calling thread.
+// Afterwards typeTable holds every declared name, as it does after check().
+//
+// Returns true if the program may be evaluated
+extern bool checkParallel(const ParseTree *program, WorkStealingPool& pool);
+
+#endif /* PARALLELCHECK_H_ */
@@ -1,16 +1,51 @@
 #include <string>
 using std::string;
 
+#include <vector>
+using std::vector;
+
 #include "parser.h"
+#include "semantic.h"
+#include "share.h"
+#include "stats.h"
+
+thread_local bool hasParseErrors = false;
+// number of diagnostics printed so far on this thread
+thread_local int errorCount = 0;
+
+static Context defaultContext;
+thread_local Context *theContext = &defaultContext;
+thread_local ostream *theOutput = &std::cout;
+thread_local OperandEvaluator *theOperandEvaluator = 0;
+thread_local SemanticCheck *theFusedCheck = 0;
+thread_local const LineTable *theLineTable = 0;
+
+// Print the parse error to the output of the current thread
+// If the input is file (as indicated by non-null inputFileName pointer),
+// prepend the error message with "filename:"
+void error(int linenum, const string& message)
+{
+    if (theContext->inputFileName)
+    {
+        *theOutput << *theContext->inputFileName << ":";
+    }
+    PARSER_PROBE2(error, linenum+1, message.c_str());
+    *theOutput << linenum+1 << ":" << message << std::endl;
+    ++errorCount;
+}
 
 class ParserToken
 {
 private:
     Token	tok;
     bool	pushedBack;
+    // tokens to parse instead of lexing the stream, see StmtFromTokens()
+    const vector<Token>	*buffer;
+    size_t				next;
+    bool				final;
 
 public:
-    ParserToken() : pushedBack(false) {}
+    ParserToken() : pushedBack(false), buffer(0), next(0), final(false) {}
 
     Token getToken(istream *in)
     {
@@ -19,9 +54,40 @@ public:
             pushedBack = false;
             return tok;
         }
+        if (buffer != 0)
+        {
+            if (next < buffer->size())
+            {
+                return (*buffer)[next++];
+            }
+            if (!final)
+            {
+                throw NeedMoreInput();
+            }
+            // like getToken at the end of a stream, keep returning T_DONE
+            return buffer->back();
+        }
+        if (theStats != 0)
+        {
+            ++theStats->tokens;
+        }
         return ::getToken(in);
     }
 
+    void useBuffer(const vector<Token> *tokens, bool isFinal)
+    {
+        buffer = tokens;
+        next = 0;
+        final = isFinal;
+        pushedBack = false;
+    }
+
+    // number of buffered tokens the parser has consumed
+    size_t consumed() const
+    {
+        return next - (pushedBack && buffer != 0 ? 1 : 0);
+    }
+
     void pushbackToken(const Token& t)
     {
         if (pushedBack)
@@ -31,11 +97,20 @@ public:
         tok = t;
         pushedBack = true;
     }
-} ParserToken;
+
+    // forget the pushed back token of a previous program
+    void reset()
+    {
+        pushedBack = false;
+    }
+};
+
+static thread_local class ParserToken ParserToken;
 
 // helper methods that print specific type of error message and set parse error flag
 void syntaxError(int line, string text)
 {
+    PARSER_PROBE2(syntax_error, line+1, text.c_str());
     error(line, "Syntax error " + text);
     hasParseErrors = true;
 }
@@ -56,9 +131,79 @@ Identifier* checkIdentifier(const Token& id)
     return 0;
 }
 
+// helpers for the fused check, doing nothing unless it runs
+// they make the checks in the order the SemanticCheck traversal makes them
+
+// stores the type of a new expression node
+ParseTree* typed(ParseTree *expr)
+{
+    if (theFusedCheck != 0)
+    {
+        expr->annotateType(expr->GetType());
+    }
+    return expr;
+}
+
+Identifier* checkedUse(Identifier *identifier)
+{
+    if (theFusedCheck != 0)
+    {
+        theFusedCheck->checkUse(identifier);
+        typed(identifier);
+    }
+    return identifier;
+}
+
+ParseTree* checkedOperation(ParseTree *op)
+{
+    if (theFusedCheck != 0)
+    {
+        typed(op);
+        theFusedCheck->checkOperation(op);
+    }
+    return op;
+}
+
+// builds the node for an operator, shared if hash-consing is on
+ParseTree* newOperation(const Token& op, ParseTree *t1, ParseTree *t2)
+{
+    if (theNodeSharing != 0)
+    {
+        return theNodeSharing->operation(op, t1, t2);
+    }
+    switch (op.GetTokenType())
+    {
+        case T_PLUS:
+            return new Addition(op.GetLinenum(), t1, t2);
+        case T_MINUS:
+            return new Subtraction(op.GetLinenum(), t1, t2);
+        case T_STAR:
+            return new Multiplication(op.GetLinenum(), t1, t2);
+        default:
+            return new Division(op.GetLinenum(), t1, t2);
+    }
+}
+
+// Frees the nodes a syntax error left without a statement; hash-consed nodes
+// may belong to statements parsed before, so they are left alone
+static void discard(ParseTree *tree)
+{
+    if (theNodeSharing == 0)
+    {
+        delete tree;
+    }
+}
+
+// the lines the statement just parsed keeps for its shared nodes
+const LineTable* statementLines()
+{
+    return theNodeSharing != 0 ? theNodeSharing->endStatement() : 0;
+}
+
 // Prog ::= StmtList
 ParseTree* Prog(istream* in)
 {
+    ParserToken.reset();
     return StmtList(in);
 }
 
@@ -75,6 +220,7 @@ ParseTree* StmtList(istream* in)
                 break;
             default:
                 syntaxError(semicolon.GetLinenum(), "semicolon required");
+                discard(stmt);
                 return 0;
         }
         return new StatementList(stmt, StmtList(in));
@@ -82,12 +228,45 @@ ParseTree* StmtList(istream* in)
     return 0;
 }
 
+// Parses one Stmt T_SC from tokens, exactly as StmtList() parses it from a stream
+ParseTree* StmtFromTokens(const vector<Token>& tokens, size_t& used, bool final)
+{
+    struct BufferGuard
+    {
+        ~BufferGuard() { ParserToken.useBuffer(0, false); }
+    } guard;
+
+    ParserToken.useBuffer(&tokens, final);
+    ParseTree *stmt = Stmt(0);
+    if (stmt != 0)
+    {
+        Token semicolon = ParserToken.getToken(0);
+        if (semicolon != T_SC)
+        {
+            syntaxError(semicolon.GetLinenum(), "semicolon required");
+            discard(stmt);
+            stmt = 0;
+        }
+    }
+    used = ParserToken.consumed();
+    return stmt;
+}
+
 // Stmt ::=  Decl | Set | Print
 ParseTree* Stmt(istream* in)
 {
     // look ahead and see what token is next
     Token token = ParserToken.getToken(in);
     ParserToken.pushbackToken(token);
+    if (theNodeSharing != 0)
+    {
+        theNodeSharing->beginStatement();
+    }
+    if (token == T_DONE)
+    {
+        return 0;
+    }
+    PARSER_PROBE1(statement_start, token.GetLinenum()+1);
 
     ParseTree *stmt = 0;
     // check if token matches one of the possible choices
@@ -104,12 +283,11 @@ ParseTree* Stmt(istream* in)
         case T_PRINTLN:
             stmt = Print(in);
             break;
-        case T_DONE:
-            return 0;
         default:
             syntaxError(token.GetLinenum(), "statement expected");
-            return 0;
+            break;
     }
+    PARSER_PROBE2(statement_end, token.GetLinenum()+1, (int)(stmt != 0));
     return stmt;
 }
 
@@ -122,7 +300,12 @@ ParseTree *	Decl(istream* in)
 
     if (Identifier *identifier = checkIdentifier(id))
     {
-        return new VariableDeclaration(declarationType, identifier);
+        VariableDeclaration *varDecl = new VariableDeclaration(declarationType, identifier);
+        if (theFusedCheck != 0)
+        {
+            theFusedCheck->checkDeclaration(varDecl);
+        }
+        return varDecl;
     }
     else
     {
@@ -139,14 +322,22 @@ ParseTree *	Set(istream* in)
     Token id = ParserToken.getToken(in);
     if (Identifier *identifier = checkIdentifier(id))
     {
+        checkedUse(identifier);
         ParseTree *expr = Expr(in);
         if (expr != 0)
         {
-            return new VariableAssignment(set, identifier, expr);
+            VariableAssignment *varAssign = new VariableAssignment(set, identifier, expr);
+            if (theFusedCheck != 0)
+            {
+                theFusedCheck->checkAssignment(varAssign);
+            }
+            varAssign->setLines(statementLines());
+            return varAssign;
         }
         else
         {
             syntaxError(id.GetLinenum(), "expression required");
+            delete identifier;
         }
     }
     return 0;
@@ -160,7 +351,9 @@ ParseTree* Print(istream* in)
     ParseTree *expr = Expr(in);
     if (expr != 0)
     {
-        return new PrintCommand(keyword, expr);
+        PrintCommand *printCmd = new PrintCommand(keyword, expr);
+        printCmd->setLines(statementLines());
+        return printCmd;
     }
     else
     {
@@ -188,18 +381,12 @@ ParseTree* Expr(istream* in)
             if( t2 == 0 )
             {
                 syntaxError(op.GetLinenum(), "expression required after + or - operator");
+                discard(t1);
                 return 0;
             }
 
             // combine t1 and t2 together
-            if( op == T_PLUS )
-            {
-                t1 = new Addition(op.GetLinenum(), t1, t2);
-            }
-            else
-            {
-                t1 = new Subtraction(op.GetLinenum(), t1, t2);
-            }
+            t1 = checkedOperation(newOperation(op, t1, t2));
         }
     }
     return 0;
@@ -226,17 +413,11 @@ ParseTree*	Term(istream* in)
             if (t2 == 0)
             {
                 syntaxError(op.GetLinenum(), "term required after * or / operator");
+                discard(t1);
                 return 0;
             }
 
-            if (op == T_STAR)
-            {
-                t1 = new Multiplication(op.GetLinenum(), t1, t2);
-            }
-            else
-            {
-                t1 = new Division(op.GetLinenum(), t1, t2);
-            }
+            t1 = checkedOperation(newOperation(op, t1, t2));
         }
     }
     else
@@ -256,11 +437,11 @@ ParseTree*	Primary(istream* in)
     switch(firstToken.GetTokenType())
     {
         case T_ICONST:
-            return new IntegerConstant(firstToken);
+            return typed(theNodeSharing != 0 ? theNodeSharing->integerConstant(firstToken) : new IntegerConstant(firstToken));
         case T_SCONST:
-            return new StringConstant(firstToken);
+            return typed(theNodeSharing != 0 ? theNodeSharing->stringConstant(firstToken) : new StringConstant(firstToken));
         case T_ID:
-            return new Identifier(firstToken);
+            return checkedUse(theNodeSharing != 0 ? theNodeSharing->identifier(firstToken) : new Identifier(firstToken));
         case T_LPAREN:
         {
             ParseTree *expr = Expr(in);
@@ -271,11 +452,17 @@ ParseTree*	Primary(istream* in)
                     return expr;
                 default:
                     syntaxError(lastToken.GetLinenum(), "right paren expected");
+                    discard(expr);
                     break;
             }
             break;
         }
         default:
+            if (firstToken == T_ERROR && firstToken.GetIntValue() == LEX_INVALID_UTF8)
+            {
+                syntaxError(firstToken.GetLinenum(), "invalid UTF-8 in string constant");
+                break;
+            }
             syntaxError(firstToken.GetLinenum(), "primary expected");
             break;
     }
@@ -7,35 +7,49 @@ using std::istream;
 using std::ostream;
 
 #include <string>
+#include <string_view>
 
 using std::string;
-using std::stoi;
 
 #include <map>
 using std::map;
 
+#include <vector>
+#include <atomic>
+#include <unordered_map>
+
 #include "lexer.h"
+#include "memory.h"
+#include "governor.h"
+#include "scratch.h"
+#include "probes.h"
 
 // indicates if parse errors were present
-extern bool hasParseErrors;
+extern thread_local bool hasParseErrors;
+extern thread_local int errorCount;
 extern void error(int linenum, const string& message);
 
 enum TypeForNode { INT_TYPE, STRING_TYPE, ERROR_TYPE, EMPTY_TYPE };
 
+// The string of a value is on scratch while a statement computes it, see scratch.h
+typedef std::basic_string<char, std::char_traits<char>, ScratchAllocator<char> > ValueString;
+
 struct Value
 {
     TypeForNode type;
     int intValue;
-    string stringValue;
+    ValueString stringValue;
 
     static Value Integer(int v = 0)
     {
         return Value(v);
     }
 
-    static Value String(string s = "")
+    static Value String(std::string_view s = std::string_view())
     {
-        return Value(s);
+        Value val(STRING_TYPE);
+        val.stringValue.assign(s.data(), s.size());
+        return val;
     }
 
     static Value Error(string error = "")
@@ -58,11 +72,6 @@ private:
               intValue(v)
     {
     }
-    Value(string s)
-            : type(STRING_TYPE),
-              stringValue(s)
-    {
-    }
     Value(TypeForNode type)
             : type(type)
     {
@@ -82,6 +91,22 @@ inline ostream& operator<<(ostream& os, const Value& v)
     return os;
 }
 
+// Asks the governor of this thread, if there is one, whether a string of bytes
+// may be built from operands of operandBytes; the error to return if not
+inline bool overLimit(size_t bytes, size_t operandBytes, Value& error)
+{
+    if (theGovernor != 0)
+    {
+        const char *limit = theGovernor->admit(bytes, operandBytes);
+        if (limit != 0)
+        {
+            error = Value::Error(limit);
+            return true;
+        }
+    }
+    return false;
+}
+
 inline Value operator+(const Value& u, const Value& v)
 {
     if (u.type == INT_TYPE && v.type == INT_TYPE)
@@ -90,7 +115,18 @@ inline Value operator+(const Value& u, const Value& v)
     }
     if (u.type == STRING_TYPE && v.type == STRING_TYPE)
     {
-        return Value::String(u.stringValue + v.stringValue);
+        size_t bytes = u.stringValue.size() + v.stringValue.size();
+        Value error;
+        if (overLimit(bytes, bytes, error))
+        {
+            return error;
+        }
+        PARSER_PROBE1(value_alloc, bytes);
+        Value val = Value::String();
+        val.stringValue.reserve(bytes);
+        val.stringValue += u.stringValue;
+        val.stringValue += v.stringValue;
+        return val;
     }
     return Value::Error();
 }
@@ -112,23 +148,47 @@ inline Value operator*(const Value& u, const Value& v)
     }
     if (u.type == INT_TYPE && v.type == STRING_TYPE)
     {
-        string accum = "";
         int count = u.intValue;
+        // the loop below runs 2^32 + count times for a negative count
+        size_t bytes = (unsigned)count * v.stringValue.size();
+        Value error;
+        if (overLimit(bytes, v.stringValue.size(), error))
+        {
+            return error;
+        }
+        PARSER_PROBE1(value_alloc, bytes);
+        Value val = Value::String();
+        if (count > 0)
+        {
+            val.stringValue.reserve(bytes);
+        }
         while (count--)
         {
-            accum += v.stringValue;
+            val.stringValue += v.stringValue;
         }
-        return Value::String(accum);
+        return val;
     }
     if (v.type == INT_TYPE && u.type == STRING_TYPE)
     {
-        string accum = "";
         int count = v.intValue;
+        // the loop below runs 2^32 + count times for a negative count
+        size_t bytes = (unsigned)count * u.stringValue.size();
+        Value error;
+        if (overLimit(bytes, u.stringValue.size(), error))
+        {
+            return error;
+        }
+        PARSER_PROBE1(value_alloc, bytes);
+        Value val = Value::String();
+        if (count > 0)
+        {
+            val.stringValue.reserve(bytes);
+        }
         while (count--)
         {
-            accum += u.stringValue;
+            val.stringValue += u.stringValue;
         }
-        return Value::String(accum);
+        return val;
     }
     return Value::Error();
 }
@@ -160,37 +220,246 @@ inline Value operator/(const Value& u, const Value& v)
     return Value::Error();
 }
 
-extern map<string, Value> symbolTable;
-extern map<string, TypeForNode> typeTable;
+// The variable tables charge their memory to MEM_TABLES, see memory.h
+typedef std::unordered_map<Atom, Value, std::hash<Atom>, std::equal_to<Atom>,
+                           CategoryAllocator<std::pair<const Atom, Value>, MEM_TABLES> > SymbolTable;
+typedef std::unordered_map<Atom, TypeForNode, std::hash<Atom>, std::equal_to<Atom>,
+                           CategoryAllocator<std::pair<const Atom, TypeForNode>, MEM_TABLES> > TypeTable;
+
+// Everything one run of a program reads and writes
+// Each thread runs against the context theContext points to, so several
+// programs can be checked and evaluated side by side in one process
+// Variables are keyed by the atoms of their names
+struct Context
+{
+    SymbolTable symbolTable;
+    TypeTable typeTable;
+    // name of the input file to prefix messages with, or null for standard input
+    const string *inputFileName;
+
+    Context() : inputFileName(0) {}
+
+    // Storage of a variable, created on first use
+    // Existing variables are only looked up, never inserted, so threads may
+    // evaluate statements on different variables of one context at once
+    Value& variable(Atom name)
+    {
+        SymbolTable::iterator it = symbolTable.find(name);
+        if (it != symbolTable.end())
+        {
+            return it->second;
+        }
+        return symbolTable[name];
+    }
+};
+
+extern thread_local Context *theContext;
+// where print, println and error messages go, standard output by default
+extern thread_local ostream *theOutput;
 
 // forward declaration of visitor class
 // ParseTree needs it, but visitor also needs classes depending on ParseTree
 class ParseTreeVisitor;
+class SemanticCheck;
+
+// The semantic check run by the parser as it builds nodes, null if there is none
+// See parseAndCheck() in semantic.h
+extern thread_local SemanticCheck *theFusedCheck;
+
+class ParseTree;
+
+// Lines of the nodes of one statement, for the nodes hash-consing shares with
+// other statements (see share.h): a shared node of the statement is on the
+// line lines gives for it, or else on line
+struct LineTable
+{
+    int line;
+    std::unordered_map<const ParseTree*, int> lines;
+
+    LineTable() : line(0) {}
+};
+
+// lines of the statement being parsed, checked or evaluated on this thread, or null
+extern thread_local const LineTable *theLineTable;
+
+// Makes lines the line table of the thread while the scope lasts
+class LineScope
+{
+    const LineTable	*saved;
+
+public:
+    explicit LineScope(const LineTable *lines) : saved(theLineTable) { theLineTable = lines; }
+    ~LineScope() { theLineTable = saved; }
+};
+
+// value of a constant subtree, once it has been evaluated, see share.h
+struct SharedValue;
 
 class ParseTree {
     int			linenumber;
+    // set on operations whose operands are worth evaluating in parallel
+    bool		forkOperands;
+    // set by the fused check, which stores the type while parsing
+    bool		typeAnnotated;
+    // set by hash-consing on nodes that occur more than once,
+    // and on constant subtrees among them
+    bool		shared;
+    bool		valueShared;
+    TypeForNode	annotatedType;
     ParseTree	*left;
     ParseTree	*right;
 
 public:
-    ParseTree(int n, ParseTree *l = 0, ParseTree *r = 0) : linenumber(n), left(l), right(r) {}
-    virtual ~ParseTree() {}
+    // the value of a shared constant subtree, null until it is first evaluated
+    mutable std::atomic<const SharedValue*> sharedValue;
+
+    ParseTree(int n, ParseTree *l = 0, ParseTree *r = 0)
+            : linenumber(n), forkOperands(false), typeAnnotated(false), shared(false), valueShared(false),
+              annotatedType(ERROR_TYPE), left(l), right(r), sharedValue(0)
+    {
+    }
+    // A tree owns its children, except the nodes hash-consing shares between
+    // statements (see share.h), which belong to no one parent and are never freed
+    virtual ~ParseTree()
+    {
+        deleteChild(left);
+        deleteChild(right);
+    }
+
+protected:
+    static void deleteChild(const ParseTree *child)
+    {
+        if (child != 0 && !child->shared)
+        {
+            delete child;
+        }
+    }
+
+public:
+    // Gives up the children, which whoever took them then owns
+    void detachChildren()
+    {
+        left = 0;
+        right = 0;
+    }
+
+    // nodes are charged to MEM_NODES, see memory.h
+    static void* operator new(size_t size)
+    {
+        MemoryScope scope(MEM_NODES);
+        return ::operator new(size);
+    }
+    static void operator delete(void *node)
+    {
+        ::operator delete(node);
+    }
 
     ParseTree* getLeft() const { return left; }
     ParseTree* getRight() const { return right; }
-    int getLineNumber() const { return linenumber; }
+    // for trees of statements that moved in their source, see incremental.h
+    void moveLines(int delta) { linenumber += delta; }
+    // A node shared by several statements is on the line the statement at hand has it on
+    int getLineNumber() const
+    {
+        if (shared && theLineTable != 0)
+        {
+            std::unordered_map<const ParseTree*, int>::const_iterator it = theLineTable->lines.find(this);
+            return it != theLineTable->lines.end() ? it->second : theLineTable->line;
+        }
+        return linenumber;
+    }
+
+    bool getForkOperands() const { return forkOperands; }
+    void setForkOperands(bool fork) { forkOperands = fork; }
 
     virtual TypeForNode GetType() const { return ERROR_TYPE; }
+    // The type stored while parsing, if there is one, so it isn't computed
+    // again from the whole subtree
+    TypeForNode GetCheckedType() const { return typeAnnotated ? annotatedType : GetType(); }
+    void annotateType(TypeForNode type)
+    {
+        annotatedType = type;
+        typeAnnotated = true;
+    }
     virtual int GetIntValue() const { throw "no integer value"; }
     virtual string GetStringValue() const { throw "no string value"; }
 
     virtual Value Evaluate() const = 0;
 
+    bool isShared() const { return shared; }
+    void setShared() { shared = true; }
+    bool isValueShared() const { return valueShared; }
+    void setValueShared() { valueShared = true; }
+    // Evaluates an expression, reusing the value of a shared constant subtree
+    Value EvaluateExpr() const;
+
     // accept visitor
     // derived classes override this method to perform tree traversal
     virtual void accept(ParseTreeVisitor *visitor) const = 0;
 };
 
+// Evaluates a shared constant subtree once and keeps its value, see share.cpp
+extern Value evaluateShared(const ParseTree *expr);
+
+// The profiler of the evaluation on this thread, or null, see profile.h
+class LineProfiler;
+extern thread_local LineProfiler *theProfiler;
+extern Value profileEvaluate(const ParseTree *node);
+
+inline Value ParseTree::EvaluateExpr() const
+{
+    if (theProfiler != 0)
+    {
+        return profileEvaluate(this);
+    }
+    if (PARSER_PROBE_ENABLED(eval_entry) || PARSER_PROBE_ENABLED(eval_exit))
+    {
+        PARSER_PROBE2(eval_entry, this, getLineNumber()+1);
+        Value val = valueShared ? evaluateShared(this) : Evaluate();
+        PARSER_PROBE3(eval_exit, this, getLineNumber()+1, (int)val.type);
+        return val;
+    }
+    return valueShared ? evaluateShared(this) : Evaluate();
+}
+
+// Strategy for evaluating both operands of a binary operation
+// The evaluator installed for the current thread may evaluate them in parallel
+// (see forkjoin.h); it must leave the output in the same order as evaluateOperands
+class OperandEvaluator
+{
+public:
+    virtual ~OperandEvaluator() {}
+    virtual void evaluate(const ParseTree *op, Value& left, Value& right) = 0;
+};
+
+extern thread_local OperandEvaluator *theOperandEvaluator;
+
+// The right operand is evaluated first, which is the order the operator
+// expressions in Evaluate() have always been compiled to, so error messages
+// from both operands keep their order
+inline void evaluateOperands(const ParseTree *op, Value& left, Value& right)
+{
+    if (theOperandEvaluator != 0)
+    {
+        theOperandEvaluator->evaluate(op, left, right);
+        return;
+    }
+    right = op->getRight()->EvaluateExpr();
+    left = op->getLeft()->EvaluateExpr();
+}
+
+// Reports an exceeded time limit on the line of stmt, see governor.h
+inline bool outOfTime(const ParseTree *stmt)
+{
+    const char *limit = theGovernor != 0 ? theGovernor->checkTime() : 0;
+    if (limit != 0)
+    {
+        error(stmt->getLineNumber(), limit);
+        return true;
+    }
+    return false;
+}
+
 // forward declaration of all the classes that ParseTreeVisitor needs
 // it's required, because all of these classes depend on methods of ParseTreeVisitor
 class StatementList;
@@ -318,12 +587,27 @@ public:
 class StatementList : public ParseTree {
 public:
     StatementList(ParseTree *first, ParseTree *rest) : ParseTree(0, first, rest) {}
+    // the rest of a long program is freed in a loop, not by recursion
+    virtual ~StatementList()
+    {
+        ParseTree *rest = getRight();
+        deleteChild(getLeft());
+        detachChildren();
+        while (StatementList *list = dynamic_cast<StatementList*>(rest))
+        {
+            rest = list->getRight();
+            deleteChild(list->getLeft());
+            list->detachChildren();
+            delete list;
+        }
+        deleteChild(rest);
+    }
 
     virtual Value Evaluate() const
     {
         if (getLeft() != NULL)
         {
-            if (getLeft()->Evaluate().type != EMPTY_TYPE)
+            if (getLeft()->EvaluateExpr().type != EMPTY_TYPE)
                 return Value::Error();
         }
         if (getRight() != NULL)
@@ -366,14 +650,23 @@ public:
 
     virtual Value Evaluate() const
     {
-        return getLeft()->Evaluate() + getRight()->Evaluate();
+        Value left, right;
+        evaluateOperands(this, left, right);
+        Value val = left + right;
+        if (val.type == ERROR_TYPE && val.stringValue.size() > 0)
+        {
+            error(getLineNumber(), val.stringValue.c_str());
+        }
+        return val;
     }
 
     virtual TypeForNode GetType() const
     {
-        if (getLeft()->GetType() == getRight()->GetType())
+        // every operand type is computed once, or long chains take exponential time
+        TypeForNode left = getLeft()->GetCheckedType();
+        if (left == getRight()->GetCheckedType())
         {
-            return getLeft()->GetType();
+            return left;
         }
         return ERROR_TYPE;
     }
@@ -395,12 +688,14 @@ public:
 
     virtual Value Evaluate() const
     {
-        return getLeft()->Evaluate() - getRight()->Evaluate();
+        Value left, right;
+        evaluateOperands(this, left, right);
+        return left - right;
     }
 
     virtual TypeForNode GetType() const
     {
-        if (getLeft()->GetType() == INT_TYPE && getRight()->GetType() == INT_TYPE)
+        if (getLeft()->GetCheckedType() == INT_TYPE && getRight()->GetCheckedType() == INT_TYPE)
         {
             return INT_TYPE;
         }
@@ -424,16 +719,24 @@ public:
 
     virtual Value Evaluate() const
     {
-        return getLeft()->Evaluate() * getRight()->Evaluate();
+        Value left, right;
+        evaluateOperands(this, left, right);
+        Value val = left * right;
+        if (val.type == ERROR_TYPE && val.stringValue.size() > 0)
+        {
+            error(getLineNumber(), val.stringValue.c_str());
+        }
+        return val;
     }
 
     virtual TypeForNode GetType() const
     {
-        if (getLeft()->GetType() == INT_TYPE)
+        TypeForNode left = getLeft()->GetCheckedType();
+        if (left == INT_TYPE)
         {
-            return getRight()->GetType();
+            return getRight()->GetCheckedType();
         }
-        if (getLeft()->GetType() == STRING_TYPE && getRight()->GetType() == INT_TYPE)
+        if (left == STRING_TYPE && getRight()->GetCheckedType() == INT_TYPE)
         {
             return STRING_TYPE;
         }
@@ -457,19 +760,23 @@ public:
 
     virtual Value Evaluate() const
     {
-        Value val = getLeft()->Evaluate() / getRight()->Evaluate();
+        Value left, right;
+        evaluateOperands(this, left, right);
+        Value val = left / right;
         if (val.type == ERROR_TYPE && val.stringValue.size() > 0)
         {
-            error(getLineNumber(), val.stringValue);
+            error(getLineNumber(), val.stringValue.c_str());
         }
         return val;
     }
 
     virtual TypeForNode GetType() const
     {
-        if (getLeft()->GetType() == getRight()->GetType())
+        // every operand type is computed once, or long chains take exponential time
+        TypeForNode left = getLeft()->GetCheckedType();
+        if (left == getRight()->GetCheckedType())
         {
-            return getLeft()->GetType();
+            return left;
         }
         return ERROR_TYPE;
     }
@@ -480,8 +787,9 @@ class IntegerConstant : public ParseTree
     int	value;
 public:
     IntegerConstant(const Token& tok) : ParseTree(tok.GetLinenum()) {
-        value = stoi( tok.GetLexeme() );
+        value = tok.GetIntValue();
     }
+    IntegerConstant(int line, int value) : ParseTree(line), value(value) {}
 
     virtual TypeForNode GetType() const { return INT_TYPE; }
     virtual int GetIntValue() const { return value; }
@@ -500,20 +808,26 @@ public:
 
 class StringConstant : public ParseTree
 {
-    string value;
+    Atom value;
 public:
     StringConstant(const Token& token)
-            : ParseTree(token.GetLinenum())
+            : ParseTree(token.GetLinenum()),
+              value(token.GetAtom())
+    {
+    }
+    StringConstant(int line, const string& value)
+            : ParseTree(line),
+              value(theInterner->intern(value))
     {
-        value = token.GetLexeme().substr(1, token.GetLexeme().size() -2);
     }
 
     virtual TypeForNode GetType() const { return STRING_TYPE; }
-    virtual string GetStringValue() const { return value; }
+    virtual string GetStringValue() const { return string(theInterner->spelling(value)); }
+    Atom GetAtom() const { return value; }
 
     virtual Value Evaluate() const
     {
-        return Value::String(value);
+        return Value::String(theInterner->spelling(value));
     }
 
     virtual void accept(ParseTreeVisitor *visitor) const
@@ -524,15 +838,25 @@ public:
 };
 
 class Identifier : public ParseTree {
-    string identifier;
+    Atom identifier;
 public:
     Identifier(const Token& id)
             : ParseTree(id.GetLinenum()),
-              identifier(id.GetLexeme())
+              identifier(id.GetAtom())
+    {
+    }
+    Identifier(int line, const string& name)
+            : ParseTree(line),
+              identifier(theInterner->intern(name))
     {
     }
 
     string getName() const
+    {
+        return string(theInterner->spelling(identifier));
+    }
+
+    Atom getAtom() const
     {
         return identifier;
     }
@@ -545,16 +869,13 @@ public:
 
     virtual Value Evaluate() const
     {
-        return symbolTable[identifier];
+        return theContext->variable(identifier);
     }
 
     virtual TypeForNode GetType() const
     {
-        if (typeTable.find(identifier) != typeTable.end())
-        {
-            return typeTable[identifier];
-        }
-        return ERROR_TYPE;
+        TypeTable::const_iterator it = theContext->typeTable.find(identifier);
+        return it != theContext->typeTable.end() ? it->second : ERROR_TYPE;
     }
 };
 
@@ -569,10 +890,26 @@ public:
               type(keyword.GetTokenType() == T_INT ? INT_TYPE : STRING_TYPE)
     {
     }
+    VariableDeclaration(int line, TypeForNode type, Identifier *identifier)
+            : ParseTree(line),
+              type(type),
+              identifier(identifier)
+    {
+    }
+    virtual ~VariableDeclaration()
+    {
+        deleteChild(identifier);
+    }
 
     virtual Value Evaluate() const
     {
-        symbolTable[identifier->getName()] = type == INT_TYPE ? Value::Integer() : Value::String();
+        MemoryScope variables(MEM_TABLES);
+        Value& variable = theContext->variable(identifier->getAtom());
+        if (theGovernor != 0)
+        {
+            theGovernor->assign(variable.stringValue.size(), 0);
+        }
+        variable = type == INT_TYPE ? Value::Integer() : Value::String();
         return Value::Empty();
     }
 
@@ -596,19 +933,47 @@ public:
 class VariableAssignment : public ParseTree
 {
     Identifier *identifier;
+    // lines of shared nodes in the expression, or null
+    const LineTable *lines;
 public:
     VariableAssignment(const Token& keyword, Identifier *identifier, ParseTree *expr)
             : ParseTree(keyword.GetLinenum(), expr),
-              identifier(identifier)
+              identifier(identifier),
+              lines(0)
     {
     }
+    VariableAssignment(int line, Identifier *identifier, ParseTree *expr)
+            : ParseTree(line, expr),
+              identifier(identifier),
+              lines(0)
+    {
+    }
+    virtual ~VariableAssignment()
+    {
+        deleteChild(identifier);
+        delete lines;
+    }
 
     virtual Value Evaluate() const
     {
-        Value val = getLeft()->Evaluate();
+        LineScope scope(lines);
+        if (outOfTime(this))
+        {
+            return Value::Error();
+        }
+        ScratchScope scratch;
+        Value val = getLeft()->EvaluateExpr();
         if (val.type != ERROR_TYPE)
         {
-            symbolTable[identifier->getName()] = val;
+            // only the value stored leaves scratch
+            LongLivedScope stored;
+            MemoryScope variables(MEM_TABLES);
+            Value& variable = theContext->variable(identifier->getAtom());
+            if (theGovernor != 0)
+            {
+                theGovernor->assign(variable.stringValue.size(), val.stringValue.size());
+            }
+            variable = val;
             return Value::Empty();
         }
         return Value::Error();
@@ -619,8 +984,12 @@ public:
         return identifier;
     }
 
+    const LineTable* getLines() const { return lines; }
+    void setLines(const LineTable *table) { lines = table; }
+
     virtual void accept(ParseTreeVisitor *visitor) const
     {
+        LineScope scope(lines);
         if (visitor->beginVisit(this))
         {
             getLeft()->accept(visitor);
@@ -632,22 +1001,41 @@ public:
 class PrintCommand : public ParseTree
 {
     const TokenType tokenType;
+    // lines of shared nodes in the expression, or null
+    const LineTable *lines;
 public:
     PrintCommand(const Token& keyword, ParseTree *expr)
             : ParseTree(keyword.GetLinenum(), expr),
-              tokenType(keyword.GetTokenType())
+              tokenType(keyword.GetTokenType()),
+              lines(0)
     {
     }
+    PrintCommand(int line, bool newline, ParseTree *expr)
+            : ParseTree(line, expr),
+              tokenType(newline ? T_PRINTLN : T_PRINT),
+              lines(0)
+    {
+    }
+    virtual ~PrintCommand()
+    {
+        delete lines;
+    }
 
     virtual Value Evaluate() const
     {
-        Value val = getLeft()->Evaluate();
+        LineScope scope(lines);
+        if (outOfTime(this))
+        {
+            return Value::Error();
+        }
+        ScratchScope scratch;
+        Value val = getLeft()->EvaluateExpr();
         if (val.type != ERROR_TYPE)
         {
-            std::cout << val;
+            *theOutput << val;
             if (IsNewline())
             {
-                std::cout << std::endl;
+                *theOutput << std::endl;
             }
             return Value::Empty();
         }
@@ -659,8 +1047,12 @@ public:
         return tokenType == T_PRINTLN;
     }
 
+    const LineTable* getLines() const { return lines; }
+    void setLines(const LineTable *table) { lines = table; }
+
     virtual void accept(ParseTreeVisitor *visitor) const
     {
+        LineScope scope(lines);
         if (visitor->beginVisit(this))
         {
             getLeft()->accept(visitor);
@@ -669,6 +1061,16 @@ public:
     }
 };
 
+// Thrown by StmtFromTokens when the statement can't be decided from the tokens buffered so far
+struct NeedMoreInput {};
+
+// Parses the next statement and its semicolon from a buffer of tokens instead of a stream.
+// If final is false and the parser needs a token past the end of the buffer,
+// throws NeedMoreInput; if final is true, the buffer must end with T_DONE.
+// Returns the statement, or null after a syntax error or at the end of the program,
+// and sets used to the number of tokens consumed.
+extern ParseTree *	StmtFromTokens(const std::vector<Token>& tokens, size_t& used, bool final);
+
 extern ParseTree *	Prog(istream* in);
 extern ParseTree *	StmtList(istream* in);
 extern ParseTree *	Stmt(istream* in);
@@ -0,0 +1,89 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perfcount.h"
+
+const char * const perfEventNames[PERF_EVENT_COUNT] = {
+        "cycles", "instructions", "branch-misses", "L1d-misses", "LLC-misses", "dTLB-misses"
+};
+
+static uint64_t cacheMiss(uint64_t cache)
+{
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+static int openCounter(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+PerfCounters::PerfCounters()
+{
+    static const struct { uint32_t type; uint64_t config; } events[PERF_EVENT_COUNT] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+            { PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_L1D) },
+            { PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_LL) },
+            { PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_DTLB) },
+    };
+    for (int event = 0; event < PERF_EVENT_COUNT; ++event)
+    {
+        fds[event] = openCounter(events[event].type, events[event].config);
+        if (fds[event] < 0 && failure.empty())
+        {
+            failure = string(perfEventNames[event]) + ": " + strerror(errno);
+        }
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (int event = 0; event < PERF_EVENT_COUNT; ++event)
+    {
+        if (fds[event] >= 0)
+        {
+            close(fds[event]);
+        }
+    }
+}
+
+bool PerfCounters::available() const
+{
+    for (int event = 0; event < PERF_EVENT_COUNT; ++event)
+    {
+        if (fds[event] >= 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PerfCounters::read(uint64_t counts[PERF_EVENT_COUNT]) const
+{
+    for (int event = 0; event < PERF_EVENT_COUNT; ++event)
+    {
+        counts[event] = 0;
+        // value, time enabled, time running
+        uint64_t values[3];
+        if (fds[event] < 0 || ::read(fds[event], values, sizeof(values)) != (ssize_t)sizeof(values))
+        {
+            continue;
+        }
+        counts[event] = values[2] != 0 && values[2] < values[1] ? (uint64_t)((double)values[0] * values[1] / values[2])
+                                                                : values[0];
+    }
+}
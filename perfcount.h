@@ -0,0 +1,44 @@
+#ifndef PERFCOUNT_H_
+#define PERFCOUNT_H_
+
+#include <string>
+using std::string;
+
+#include <stdint.h>
+
+// Hardware performance counters through Linux perf_event_open
+//
+// Every counter is opened on its own for the calling thread, user space only,
+// and inherited by the threads it starts afterwards, so opening them before
+// the pool of -j counts its workers too. A counter the kernel or the hardware
+// doesn't offer, or that the process may not open, is left out; the others
+// still count. Counts are scaled up when the kernel had to multiplex counters.
+
+enum PerfEvent { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_BRANCH_MISSES, PERF_L1D_MISSES, PERF_LLC_MISSES,
+                 PERF_DTLB_MISSES, PERF_EVENT_COUNT };
+
+extern const char * const perfEventNames[PERF_EVENT_COUNT];
+
+class PerfCounters
+{
+    int		fds[PERF_EVENT_COUNT];
+    // why the first counter that failed couldn't be opened
+    string	failure;
+
+    PerfCounters(const PerfCounters&);
+    PerfCounters& operator=(const PerfCounters&);
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    bool available(PerfEvent event) const { return fds[event] >= 0; }
+    // true if any counter could be opened
+    bool available() const;
+    const string& getFailure() const { return failure; }
+
+    // Reads the counts so far; those of unavailable counters are 0
+    void read(uint64_t counts[PERF_EVENT_COUNT]) const;
+};
+
+#endif /* PERFCOUNT_H_ */
@@ -0,0 +1,13 @@
+#include "probes.h"
+
+#ifdef PARSER_PROBE_SEMAPHORES
+
+// Tracers find the semaphores through the notes and increment them in place
+#define PARSER_PROBE_DEFINE_SEMAPHORE(name) \
+    volatile unsigned short parser_##name##_semaphore __attribute__((section(".probes"))) = 0;
+extern "C"
+{
+PARSER_PROBE_SEMAPHORES(PARSER_PROBE_DEFINE_SEMAPHORE)
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef PROBES_H_
+#define PROBES_H_
+
+#include <type_traits>
+
+// Static tracing probes (USDT) of the provider "parser"
+//
+// Every probe is a nop with a .note.stapsdt note telling tracers (perf probe,
+// bpftrace, SystemTap, gdb) where the nop is and where its arguments are, in
+// the format sys/sdt.h writes. A probe has a semaphore that tracers increment
+// while they are attached; until then the probe is a test of the semaphore and
+// its arguments are never computed. List them with
+//
+//     readelf -n parser | grep -A4 stapsdt
+//
+// Building with -DNO_PROBES, or for anything but x86-64 with GCC or clang,
+// leaves them out. Lines count from 1, as in the error messages.
+//
+//     token(type, line)              every token getToken() returns
+//     statement_start(line)          Stmt() starts parsing a statement
+//     statement_end(line, parsed)    and ends, parsed is 0 after an error
+//     syntax_error(line, text)       syntaxError()
+//     error(line, message)           every error printed
+//     eval_entry(node, line)         EvaluateExpr() of every node
+//     eval_exit(node, line, type)    and its return, with the type of the value
+//     value_alloc(bytes)             a string built by + or *
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(NO_PROBES)
+
+#define PARSER_PROBE_SEMAPHORES(X) \
+    X(token) X(statement_start) X(statement_end) X(syntax_error) X(error) \
+    X(eval_entry) X(eval_exit) X(value_alloc)
+
+#define PARSER_PROBE_DECLARE_SEMAPHORE(name) extern "C" volatile unsigned short parser_##name##_semaphore;
+PARSER_PROBE_SEMAPHORES(PARSER_PROBE_DECLARE_SEMAPHORE)
+
+#define PARSER_PROBE_ENABLED(name) __builtin_expect(parser_##name##_semaphore != 0, 0)
+
+// Size of an argument as the note gives it, negative if it is signed
+// %n prints the constant negated, so this is the other way round
+template <class T>
+constexpr int probeArgumentSize()
+{
+    return (std::is_signed<T>::value ? 1 : -1) * (int)sizeof(T);
+}
+
+#define PARSER_PROBE_SIZE(x) probeArgumentSize<typename std::decay<decltype(x)>::type>()
+
+#define PARSER_PROBE_NOTE(name, arguments, ...) \
+    __asm__ __volatile__ ( \
+        "990: nop\n" \
+        ".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+        ".balign 4\n" \
+        ".4byte 992f-991f, 994f-993f, 3\n" \
+        "991: .asciz \"stapsdt\"\n" \
+        "992: .balign 4\n" \
+        "993: .8byte 990b\n" \
+        ".8byte _.stapsdt.base\n" \
+        ".8byte parser_" #name "_semaphore\n" \
+        ".asciz \"parser\"\n" \
+        ".asciz \"" #name "\"\n" \
+        ".asciz \"" arguments "\"\n" \
+        "994: .balign 4\n" \
+        ".popsection\n" \
+        ".ifndef _.stapsdt.base\n" \
+        ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+        ".weak _.stapsdt.base\n" \
+        ".hidden _.stapsdt.base\n" \
+        "_.stapsdt.base: .space 1\n" \
+        ".size _.stapsdt.base, 1\n" \
+        ".popsection\n" \
+        ".endif\n" \
+        : : __VA_ARGS__)
+
+#define PARSER_PROBE_ARGUMENT(n, x) [_a##n] "nor" (x), [_s##n] "n" (PARSER_PROBE_SIZE(x))
+
+#define PARSER_PROBE1(name, a1) \
+    do { \
+        if (PARSER_PROBE_ENABLED(name)) \
+            PARSER_PROBE_NOTE(name, "%n[_s1]@%[_a1]", PARSER_PROBE_ARGUMENT(1, a1)); \
+    } while (0)
+
+#define PARSER_PROBE2(name, a1, a2) \
+    do { \
+        if (PARSER_PROBE_ENABLED(name)) \
+            PARSER_PROBE_NOTE(name, "%n[_s1]@%[_a1] %n[_s2]@%[_a2]", \
+                              PARSER_PROBE_ARGUMENT(1, a1), PARSER_PROBE_ARGUMENT(2, a2)); \
+    } while (0)
+
+#define PARSER_PROBE3(name, a1, a2, a3) \
+    do { \
+        if (PARSER_PROBE_ENABLED(name)) \
+            PARSER_PROBE_NOTE(name, "%n[_s1]@%[_a1] %n[_s2]@%[_a2] %n[_s3]@%[_a3]", \
+                              PARSER_PROBE_ARGUMENT(1, a1), PARSER_PROBE_ARGUMENT(2, a2), \
+                              PARSER_PROBE_ARGUMENT(3, a3)); \
+    } while (0)
+
+#else
+
+#define PARSER_PROBE_ENABLED(name) false
+#define PARSER_PROBE1(name, a1) do {} while (0)
+#define PARSER_PROBE2(name, a1, a2) do {} while (0)
+#define PARSER_PROBE3(name, a1, a2, a3) do {} while (0)
+
+#endif
+
+#endif /* PROBES_H_ */
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <iomanip>
+
+#include "profile.h"
+
+thread_local LineProfiler *theProfiler = 0;
+
+Value profileEvaluate(const ParseTree *node)
+{
+    return theProfiler->evaluate(node);
+}
+
+LineProfiler::LineProfiler() : root(-1), total(0)
+{
+}
+
+LineProfiler::LineRecord& LineProfiler::record(int line)
+{
+    if (line < 0)
+    {
+        line = 0;
+    }
+    if ((size_t)line >= records.size())
+    {
+        records.resize(line + 1);
+    }
+    return records[line];
+}
+
+Value LineProfiler::evaluate(const ParseTree *node)
+{
+    int line = node->getLineNumber();
+    CallNode *parent = stack.empty() ? &root : stack.back().node;
+    // still on the line of the parent: counted, but not timed on its own
+    if (parent->line == line)
+    {
+        Value val = node->isValueShared() ? evaluateShared(node) : node->Evaluate();
+        if (val.type == STRING_TYPE)
+        {
+            record(line).profile.stringBytes += val.stringValue.size();
+        }
+        return val;
+    }
+
+    std::unique_ptr<CallNode>& child = parent->children[line];
+    if (!child)
+    {
+        child.reset(new CallNode(line));
+    }
+    Frame frame = { child.get(), std::chrono::steady_clock::now(), std::chrono::nanoseconds(0) };
+    stack.push_back(frame);
+    ++record(line).active;
+
+    Value val = node->isValueShared() ? evaluateShared(node) : node->Evaluate();
+
+    std::chrono::nanoseconds inclusive = std::chrono::steady_clock::now() - stack.back().start;
+    CallNode *called = stack.back().node;
+    called->self += inclusive - stack.back().children;
+    stack.pop_back();
+    if (!stack.empty())
+    {
+        stack.back().children += inclusive;
+    }
+    else
+    {
+        total += inclusive;
+    }
+
+    LineRecord& lineRecord = record(line);
+    ++lineRecord.profile.count;
+    if (--lineRecord.active == 0)
+    {
+        lineRecord.profile.time += inclusive;
+    }
+    if (val.type == STRING_TYPE)
+    {
+        lineRecord.profile.stringBytes += val.stringValue.size();
+    }
+    return val;
+}
+
+std::map<int, LineProfile> LineProfiler::lines() const
+{
+    std::map<int, LineProfile> result;
+    for (size_t line = 0; line < records.size(); ++line)
+    {
+        const LineProfile& profile = records[line].profile;
+        if (profile.count != 0 || profile.stringBytes != 0)
+        {
+            result[line + 1] = profile;
+        }
+    }
+    return result;
+}
+
+static bool slowerLine(const std::pair<int, LineProfile>& a, const std::pair<int, LineProfile>& b)
+{
+    if (a.second.time != b.second.time)
+    {
+        return a.second.time > b.second.time;
+    }
+    return a.first < b.first;
+}
+
+void LineProfiler::printTop(std::ostream& out, size_t top) const
+{
+    std::map<int, LineProfile> profiled = lines();
+    std::vector<std::pair<int, LineProfile> > sorted(profiled.begin(), profiled.end());
+    std::sort(sorted.begin(), sorted.end(), slowerLine);
+
+    std::ios::fmtflags flags = out.flags();
+    out << "profile: " << sorted.size() << " lines evaluated in "
+        << std::chrono::duration_cast<std::chrono::microseconds>(total).count() << " us" << std::endl;
+    out << std::setw(8) << "line" << std::setw(12) << "count" << std::setw(14) << "time us"
+        << std::setw(8) << "%" << std::setw(16) << "string bytes" << std::endl;
+    out << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < sorted.size() && i < top; ++i)
+    {
+        const LineProfile& profile = sorted[i].second;
+        double share = total.count() > 0 ? 100.0 * profile.time.count() / total.count() : 0;
+        out << std::setw(8) << sorted[i].first << std::setw(12) << profile.count
+            << std::setw(14) << std::chrono::duration_cast<std::chrono::microseconds>(profile.time).count()
+            << std::setw(8) << share << std::setw(16) << profile.stringBytes << std::endl;
+    }
+    out.flags(flags);
+}
+
+void LineProfiler::printCollapsed(std::ostream& out) const
+{
+    printCollapsed(out, root, std::string());
+}
+
+void LineProfiler::printCollapsed(std::ostream& out, const CallNode& node, const std::string& path) const
+{
+    for (std::map<int, std::unique_ptr<CallNode> >::const_iterator it = node.children.begin(); it != node.children.end(); ++it)
+    {
+        const CallNode& child = *it->second;
+        std::string childPath = path + (path.empty() ? "line " : ";line ") + std::to_string(child.line + 1);
+        if (child.self.count() > 0)
+        {
+            out << childPath << " " << child.self.count() << "\n";
+        }
+        printCollapsed(out, child, childPath);
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "parser.h"
+
+// Line-level profiler for --profile
+//
+// While a LineProfiler is installed as theProfiler, EvaluateExpr() hands every
+// node to it. Per source line it counts how often evaluation entered the line,
+// the time spent in it including everything it called, and the bytes of the
+// string values its nodes produced. Only entering or leaving a line reads the
+// clock; nodes on the line of their parent are just counted, so a statement
+// on one line costs one pair of clock reads whatever its size.
+//
+// The lines entered one inside the other form call stacks, whose self time is
+// kept for collapsed-stack output ("line 3;line 4 1200", in nanoseconds), as
+// flame graph tools read it.
+//
+// The profiler belongs to the thread evaluating the program.
+
+struct LineProfile
+{
+    // times evaluation entered the line
+    long count;
+    // inclusive time, counted once however deep the line nests in itself
+    std::chrono::nanoseconds time;
+    // bytes of the string values evaluated on the line
+    long stringBytes;
+
+    LineProfile() : count(0), time(0), stringBytes(0) {}
+};
+
+class LineProfiler
+{
+public:
+    LineProfiler();
+
+    // Evaluates node, recording it for its line
+    Value evaluate(const ParseTree *node);
+
+    // lines with a profile, by their number counted from 1
+    std::map<int, LineProfile> lines() const;
+
+    // Prints the top lines by inclusive time, with the total evaluation time
+    void printTop(std::ostream& out, size_t top) const;
+    // Prints one "line a;line b;... nanoseconds" record per call stack
+    void printCollapsed(std::ostream& out) const;
+
+private:
+    // call tree of lines; self time is the time of the line not spent in its children
+    struct CallNode
+    {
+        int line;
+        std::chrono::nanoseconds self;
+        std::map<int, std::unique_ptr<CallNode> > children;
+
+        explicit CallNode(int line) : line(line), self(0) {}
+    };
+
+    struct Frame
+    {
+        CallNode *node;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::nanoseconds children;
+    };
+
+    struct LineRecord
+    {
+        LineProfile profile;
+        // frames of the line on the stack
+        int active;
+
+        LineRecord() : active(0) {}
+    };
+
+    std::vector<LineRecord> records;
+    std::vector<Frame> stack;
+    CallNode root;
+    // time of the outermost lines, which is the whole evaluation
+    std::chrono::nanoseconds total;
+
+    LineProfiler(const LineProfiler&);
+    LineProfiler& operator=(const LineProfiler&);
+
+    LineRecord& record(int line);
+    void printCollapsed(std::ostream& out, const CallNode& node, const std::string& path) const;
+};
+
+// the profiler of the evaluation on this thread, or null
+extern thread_local LineProfiler *theProfiler;
+
+#endif /* PROFILE_H_ */
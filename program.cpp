@@ -0,0 +1,170 @@
+#include <sstream>
+#include <vector>
+
+#include "incremental.h"
+#include "program.h"
+#include "semantic.h"
+
+// Binds the interpreter state of this thread to a context and an output while
+// it lasts, and gives the thread back what it had
+class ThreadBinding
+{
+    Context				*context;
+    ostream				*output;
+    int					line;
+    bool				parseErrors;
+    int					errors;
+    ResourceGovernor	*governor;
+    Interner			*interner;
+
+public:
+    ThreadBinding(Context *boundContext, ostream *boundOutput, Interner *boundInterner)
+            : context(theContext), output(theOutput), line(lineNumber), parseErrors(hasParseErrors),
+              errors(errorCount), governor(theGovernor), interner(theInterner)
+    {
+        theContext = boundContext;
+        theOutput = boundOutput;
+        theInterner = boundInterner;
+        lineNumber = 0;
+        hasParseErrors = false;
+        errorCount = 0;
+        theGovernor = 0;
+    }
+
+    ~ThreadBinding()
+    {
+        theContext = context;
+        theOutput = output;
+        lineNumber = line;
+        hasParseErrors = parseErrors;
+        errorCount = errors;
+        theGovernor = governor;
+        theInterner = interner;
+    }
+};
+
+Program::Program(const string& source, const string& name)
+        : name(name), tree(0), interner(newInterner()), parsed(false), runnable(false)
+{
+    // the types of the check are only needed while checking
+    Context checkContext;
+    checkContext.inputFileName = name.empty() ? 0 : &this->name;
+    std::ostringstream messages;
+    {
+        ThreadBinding binding(&checkContext, &messages, interner);
+        std::istringstream in(source);
+        tree = Prog(&in);
+        parsed = !hasParseErrors;
+        runnable = parsed && (tree == 0 || check(tree));
+    }
+    diagnostics = messages.str();
+}
+
+Program::~Program()
+{
+    delete tree;
+    delete interner;
+}
+
+Execution::Execution(const Program& program, ostream& out)
+        : program(program), out(&out)
+{
+    context.inputFileName = program.getName().empty() ? 0 : &program.getName();
+}
+
+bool Execution::run()
+{
+    if (!program.isRunnable())
+    {
+        return false;
+    }
+    bool finished = true;
+    {
+        ThreadBinding binding(&context, out, program.getInterner());
+        ResourceGovernor governor(limits);
+        if (limits.any())
+        {
+            theGovernor = &governor;
+            // the strings of the last run count against the limit of this one
+            for (SymbolTable::const_iterator it = context.symbolTable.begin(); it != context.symbolTable.end(); ++it)
+            {
+                governor.assign(0, it->second.stringValue.size());
+            }
+        }
+        const ParseTree *tree = program.getTree();
+        if (tree != 0)
+        {
+            finished = tree->Evaluate().type == EMPTY_TYPE;
+        }
+    }
+    out->flush();
+    return finished;
+}
+
+void Execution::reset()
+{
+    context.symbolTable.clear();
+}
+
+const Value* Execution::variable(const string& name) const
+{
+    SymbolTable::const_iterator it = context.symbolTable.find(program.getInterner()->find(name));
+    return it != context.symbolTable.end() ? &it->second : 0;
+}
+
+EditSession::EditSession(const string& source, const string& name)
+        : name(name), interner(newInterner()), program(0)
+{
+    try
+    {
+        // the program binds a context and an output of its own while it parses and checks
+        ThreadBinding binding(0, 0, interner);
+        program = new IncrementalProgram(source);
+    }
+    catch (...)
+    {
+        delete interner;
+        throw;
+    }
+    diagnose();
+}
+
+EditSession::~EditSession()
+{
+    {
+        ThreadBinding binding(0, 0, interner);
+        delete program;
+    }
+    delete interner;
+}
+
+void EditSession::edit(size_t offset, size_t removed, const string& inserted)
+{
+    {
+        ThreadBinding binding(0, 0, interner);
+        program->edit(offset, removed, inserted);
+    }
+    diagnose();
+}
+
+void EditSession::diagnose()
+{
+    Context context;
+    context.inputFileName = name.empty() ? 0 : &name;
+    std::ostringstream messages;
+    {
+        ThreadBinding binding(&context, &messages, interner);
+        program->printDiagnostics();
+    }
+    diagnostics = messages.str();
+}
+
+const string& EditSession::getSource() const
+{
+    return program->getSource();
+}
+
+bool EditSession::isChecked() const
+{
+    return program->isChecked();
+}
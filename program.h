@@ -0,0 +1,123 @@
+#ifndef PROGRAM_H_
+#define PROGRAM_H_
+
+#include <string>
+using std::string;
+
+#include "parser.h"
+
+class IncrementalProgram;
+
+// Embedding: compile a program once, execute it many times
+//
+// A Program is parsed and checked when it is constructed, on the thread that
+// constructs it, and never changes afterwards: any number of threads may run
+// it at once, each through an Execution of its own, without locks. An
+// Execution holds the variables of its runs and the stream they print to. It
+// is a context and a pointer, so it is cheap to create, and reset() empties
+// it for the next run while keeping the memory of its tables.
+//
+// Both bind the thread-local state of the interpreter (theContext, theOutput,
+// lineNumber, hasParseErrors, errorCount, theGovernor, theInterner) only while
+// they run and put back what the thread had, so they can be used from any
+// thread, also one running a program of its own. Every program interns its
+// names in a table of its own, so freeing it gives back all of its memory.
+// An EditSession keeps a source an editor changes parsed and checked through
+// an IncrementalProgram, bound the same way. libparser.h is the C interface to
+// them.
+
+class Program
+{
+    string			name;
+    ParseTree		*tree;
+    // the names of the program, freed with it
+    Interner		*interner;
+    // what the parse and the check printed, the messages the command line prints
+    string			diagnostics;
+    bool			parsed;
+    bool			runnable;
+
+    Program(const Program&);
+    Program& operator=(const Program&);
+
+public:
+    // Parses and checks source; name prefixes its messages, like the name of
+    // an input file, unless it is empty
+    explicit Program(const string& source, const string& name = "");
+    ~Program();
+
+    // false if it has syntax errors
+    bool isParsed() const { return parsed; }
+    // true if it parsed and passed the check, so it may be run
+    bool isRunnable() const { return runnable; }
+    const string& getDiagnostics() const { return diagnostics; }
+    // the exit status of the command line interpreter for the program before it runs
+    int getStatus() const { return parsed ? 0 : 1; }
+    const string& getName() const { return name; }
+    // the checked tree, null for an empty program or one that isn't runnable
+    const ParseTree* getTree() const { return runnable ? tree : 0; }
+    // the table the atoms of the tree belong to
+    Interner* getInterner() const { return interner; }
+};
+
+class Execution
+{
+    const Program	&program;
+    Context			context;
+    ostream			*out;
+    ResourceLimits	limits;
+
+    Execution(const Execution&);
+    Execution& operator=(const Execution&);
+
+public:
+    // Runs of program print to out, which must outlive the execution
+    Execution(const Program& program, ostream& out);
+
+    // Limits every later run, see governor.h; no limits by default
+    void setLimits(const ResourceLimits& limits) { this->limits = limits; }
+
+    // Runs the program on the variables the last run left, printing its output
+    // and runtime errors, and flushes the stream
+    // Returns false if the program isn't runnable or a runtime error stopped it
+    bool run();
+
+    // Forgets every variable
+    void reset();
+
+    // The value of a variable after a run, or null if no run declared it
+    // It stays valid until the next run or reset
+    const Value* variable(const string& name) const;
+};
+
+class EditSession
+{
+    string				name;
+    // the names of the source, freed with it
+    Interner			*interner;
+    IncrementalProgram	*program;
+    // what Prog() and check() print for the source now
+    string				diagnostics;
+
+    EditSession(const EditSession&);
+    EditSession& operator=(const EditSession&);
+
+    void diagnose();
+
+public:
+    // Parses and checks source; name prefixes its messages, as for a Program
+    explicit EditSession(const string& source, const string& name = "");
+    ~EditSession();
+
+    // Replaces removed bytes at offset with inserted, both clipped to the
+    // source, and parses and checks again only what the edit touched
+    void edit(size_t offset, size_t removed, const string& inserted);
+
+    const string& getSource() const;
+    // true if the source has statements, parses and passes the check, so it may
+    // be compiled and run
+    bool isChecked() const;
+    const string& getDiagnostics() const { return diagnostics; }
+};
+
+#endif /* PROGRAM_H_ */
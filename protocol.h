@@ -0,0 +1,95 @@
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+#include <string>
+using std::string;
+
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+
+// Wire format between parserd and parser-client over a Unix domain socket
+//
+// Request:  uint32 length of the file name, the file name (empty for standard input),
+//           then the program text up to the end of the client's write side
+// Response: a sequence of frames, each a FrameHeader followed by length bytes
+//           FRAME_OUTPUT frames carry program output in order,
+//           the last frame is FRAME_STATUS with a StatusFrame payload
+//           A request the server couldn't serve, too large or failing while it ran,
+//           ends with a FRAME_ERROR frame carrying the reason and the status REQUEST_FAILED
+// All integers are in host byte order, both ends run on the same machine
+
+const char * const DEFAULT_SOCKET_PATH = "/tmp/parserd.sock";
+
+// the largest file name and program text a request may carry
+const uint32_t MAX_NAME_LENGTH = 4096;
+const size_t MAX_SOURCE_BYTES = 64 * 1024 * 1024;
+
+// exit status of a failed request, which no program exits with
+const int32_t REQUEST_FAILED = 2;
+
+enum FrameType { FRAME_OUTPUT = 'O', FRAME_STATUS = 'S', FRAME_ERROR = 'E' };
+
+struct FrameHeader
+{
+    uint8_t		type;
+    uint8_t		reserved[3];
+    uint32_t	length;
+};
+
+struct StatusFrame
+{
+    int32_t		exitStatus;
+    // time the server spent on the request, from the end of the request to the last output
+    int64_t		serviceMicros;
+};
+
+// write all of data, retrying short writes
+inline bool writeFully(int fd, const void *data, size_t size)
+{
+    const char *p = (const char*)data;
+    while (size > 0)
+    {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+// read exactly size bytes; returns false on error or early end of stream
+inline bool readFully(int fd, void *data, size_t size)
+{
+    char *p = (char*)data;
+    while (size > 0)
+    {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+inline bool writeFrame(int fd, FrameType type, const void *data, uint32_t length)
+{
+    FrameHeader header = { (uint8_t)type, { 0, 0, 0 }, length };
+    return writeFully(fd, &header, sizeof(header)) && writeFully(fd, data, length);
+}
+
+#endif /* PROTOCOL_H_ */
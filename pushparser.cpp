@@ -0,0 +1,113 @@
+#include "pushparser.h"
+
+PushParser::PushParser(const StatementHandler& handler)
+        : handler(handler),
+          scanned(0),
+          terminated(false),
+          parens(0),
+          failed(false),
+          ended(false)
+{
+}
+
+bool PushParser::feed(const char *data, size_t size)
+{
+    Token tok;
+    bool putback;
+    for (size_t i = 0; i < size && !failed && !ended; )
+    {
+        if (lexer.feed((unsigned char)data[i], tok, putback))
+        {
+            pending.push_back(tok);
+            if (isComplete())
+            {
+                parsePending(false);
+            }
+        }
+        // a character that ended the previous token is fed again as the start of the next
+        if (!putback)
+        {
+            ++i;
+        }
+    }
+    return !failed;
+}
+
+ParseTree* PushParser::finish()
+{
+    if (!failed && !ended)
+    {
+        pending.push_back(lexer.finish());
+        parsePending(true);
+    }
+    if (statements.empty())
+    {
+        return 0;
+    }
+    // StmtList() nests the list to the right, with a null tail after the last statement,
+    // and keeps the statements before a syntax error
+    ParseTree *program = 0;
+    for (size_t i = statements.size(); i-- > 0; )
+    {
+        program = new StatementList(statements[i], program);
+    }
+    return program;
+}
+
+// Whether the next statement can be parsed from the buffered tokens without running
+// out of them: a statement never reads past its T_SC, except after a syntax error
+// inside parentheses, where every ( still open reads one more token as it unwinds,
+// so as many tokens as there are ( open at the T_SC are needed after it
+bool PushParser::isComplete()
+{
+    while (!terminated && scanned < pending.size())
+    {
+        const Token& tok = pending[scanned++];
+        terminated = tok == T_SC;
+        if (tok == T_LPAREN)
+        {
+            ++parens;
+        }
+        else if (tok == T_RPAREN)
+        {
+            --parens;
+        }
+    }
+    return terminated && (parens <= 0 || pending.size() - scanned >= (size_t)parens);
+}
+
+// Parses as many complete statements as the buffered tokens hold, or all of them if final
+// A statement is only attempted once isComplete(), so the parser never runs out of
+// tokens halfway through one and the result never depends on where the input was split
+void PushParser::parsePending(bool final)
+{
+    while (!failed && !ended && (final ? !pending.empty() : isComplete()))
+    {
+        bool parseErrors = hasParseErrors;
+        hasParseErrors = false;
+
+        size_t used = 0;
+        ParseTree *stmt = StmtFromTokens(pending, used, final);
+        if (hasParseErrors)
+        {
+            failed = true;
+            return;
+        }
+        hasParseErrors = parseErrors;
+        if (stmt == 0)
+        {
+            // T_DONE where a statement would start
+            ended = true;
+            return;
+        }
+        pending.erase(pending.begin(), pending.begin() + used);
+        scanned = 0;
+        terminated = false;
+        parens = 0;
+        statements.push_back(stmt);
+        if (handler)
+        {
+            handler(stmt);
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef PUSHPARSER_H_
+#define PUSHPARSER_H_
+
+#include <functional>
+#include <vector>
+
+#include "parser.h"
+
+// Incremental parser fed with input as it arrives
+//
+// Instead of pulling characters from a blocking istream, the parser is pushed
+// chunks of input, which may split tokens, strings and comments at any byte.
+// Every statement is handed to the statement handler as soon as its T_SC has
+// been fed, or for one with unbalanced parentheses, the tokens a syntax error
+// in them would read. Diagnostics are exactly those Prog() prints for the same input,
+// and nothing ever blocks waiting for input, so one thread can serve any
+// number of parsers.
+class PushParser
+{
+public:
+    typedef std::function<void(ParseTree*)> StatementHandler;
+
+    explicit PushParser(const StatementHandler& handler = StatementHandler());
+
+    // Accepts the next chunk of input
+    // Returns false once a syntax error was reported; further input is ignored
+    bool feed(const char *data, size_t size);
+
+    // Ends the input and returns the whole program, as Prog() would have returned it:
+    // the statements before the first syntax error, or null if there were none
+    ParseTree* finish();
+
+    bool hasErrors() const { return failed; }
+
+private:
+    StatementHandler	handler;
+    Lexer				lexer;
+    // tokens of the statement being parsed
+    std::vector<Token>	pending;
+    // how far pending was searched for the T_SC of the statement, whether it was
+    // found, and how many ( are open before it
+    size_t				scanned;
+    bool				terminated;
+    int					parens;
+    bool				failed;
+    bool				ended;
+    std::vector<ParseTree*>	statements;
+
+    bool isComplete();
+    void parsePending(bool final);
+};
+
+#endif /* PUSHPARSER_H_ */
@@ -0,0 +1,31 @@
+#include "scratch.h"
+
+thread_local ScratchArena theScratchArena;
+thread_local ScratchArena *theScratch = 0;
+
+ScratchArena::~ScratchArena()
+{
+    for (const Chunk& chunk : chunks)
+    {
+        ::operator delete(chunk.begin);
+    }
+}
+
+void* ScratchArena::allocateInNextChunk(size_t size)
+{
+    size_t chunk = next != 0 ? current + 1 : 0;
+    if (size > SCRATCH_LARGE || chunk >= SCRATCH_LIMIT / SCRATCH_CHUNK)
+    {
+        return 0;
+    }
+    if (chunk == chunks.size())
+    {
+        char *begin = (char*)::operator new(SCRATCH_CHUNK);
+        Chunk added = { begin, begin + SCRATCH_CHUNK };
+        chunks.push_back(added);
+    }
+    current = chunk;
+    next = chunks[chunk].begin + size;
+    end = chunks[chunk].end;
+    return chunks[chunk].begin;
+}
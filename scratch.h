@@ -0,0 +1,173 @@
+#ifndef SCRATCH_H_
+#define SCRATCH_H_
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Scratch memory for the strings of the values computed while evaluating a statement
+//
+// Every thread has a bump-pointer arena. A statement marks it on entry and
+// rewinds it to the mark when it is done, so the strings of its intermediate
+// values are handed out by bumping a pointer and are all freed at once;
+// freeing one of them is a no-op, except that the most recent block is given
+// back. The chunks are kept for the next statement, so after the first few
+// statements evaluation hardly calls malloc at all.
+//
+// Only the values a statement keeps are copied out to the heap: see
+// LongLivedScope. Strings larger than SCRATCH_LARGE, and strings of a
+// statement that has already filled SCRATCH_LIMIT of scratch, go to the heap
+// as before, so a long chain of growing strings takes no more memory than it
+// used to.
+//
+// Marks nest, because a -j worker that waits for a forked operand may run
+// another statement in the middle of its own.
+
+const size_t SCRATCH_CHUNK = 64 * 1024;
+const size_t SCRATCH_LARGE = 16 * 1024;
+const size_t SCRATCH_LIMIT = 16 * SCRATCH_CHUNK;
+
+class ScratchArena
+{
+    struct Chunk
+    {
+        char	*begin;
+        char	*end;
+    };
+
+    std::vector<Chunk>	chunks;
+    // the chunk being filled, and its free bytes; all null before the first allocation
+    size_t				current;
+    char				*next;
+    char				*end;
+
+    ScratchArena(const ScratchArena&);
+    ScratchArena& operator=(const ScratchArena&);
+
+    static size_t rounded(size_t size) { return (size + 7) & ~(size_t)7; }
+
+    void* allocateInNextChunk(size_t size);
+
+public:
+    struct Mark
+    {
+        size_t	chunk;
+        char	*next;
+    };
+
+    ScratchArena() : current(0), next(0), end(0) {}
+    ~ScratchArena();
+
+    // Null if the block is better allocated on the heap
+    void* allocate(size_t size)
+    {
+        size = rounded(size);
+        if (size <= (size_t)(end - next))
+        {
+            void *block = next;
+            next += size;
+            return block;
+        }
+        return allocateInNextChunk(size);
+    }
+
+    bool owns(const void *block) const
+    {
+        for (const Chunk& chunk : chunks)
+        {
+            if (block >= chunk.begin && block < chunk.end)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // gives back the block if it is the last one allocated
+    void release(void *block, size_t size)
+    {
+        if ((char*)block + rounded(size) == next)
+        {
+            next = (char*)block;
+        }
+    }
+
+    Mark mark() const
+    {
+        Mark mark = { current, next };
+        return mark;
+    }
+    void rewind(const Mark& mark)
+    {
+        current = mark.chunk;
+        next = mark.next;
+        end = next != 0 ? chunks[current].end : 0;
+    }
+};
+
+// The arena of this thread, and the arena strings are allocated from now, null
+// outside of statements and in a LongLivedScope
+extern thread_local ScratchArena theScratchArena;
+extern thread_local ScratchArena *theScratch;
+
+// Allocates from the scratch arena of this thread if one is in use, from the heap if not
+// It has no state, so strings move between scratch and the heap by copying their characters
+template <class T>
+struct ScratchAllocator
+{
+    typedef T value_type;
+
+    ScratchAllocator() {}
+    template <class U>
+    ScratchAllocator(const ScratchAllocator<U>&) {}
+
+    T* allocate(size_t n)
+    {
+        void *block = theScratch != 0 ? theScratch->allocate(n * sizeof(T)) : 0;
+        return (T*)(block != 0 ? block : ::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *block, size_t n)
+    {
+        if (theScratchArena.owns(block))
+        {
+            theScratchArena.release(block, n * sizeof(T));
+        }
+        else
+        {
+            ::operator delete(block);
+        }
+    }
+
+    template <class U>
+    bool operator==(const ScratchAllocator<U>&) const { return true; }
+    template <class U>
+    bool operator!=(const ScratchAllocator<U>&) const { return false; }
+};
+
+// Evaluates a statement on scratch: everything it allocated there is freed at the end
+class ScratchScope
+{
+    ScratchArena		*saved;
+    ScratchArena::Mark	start;
+
+public:
+    ScratchScope() : saved(theScratch), start(theScratchArena.mark()) { theScratch = &theScratchArena; }
+    ~ScratchScope()
+    {
+        theScratchArena.rewind(start);
+        theScratch = saved;
+    }
+};
+
+// Allocates on the heap while it lasts, for values that outlive the statement
+class LongLivedScope
+{
+    ScratchArena	*saved;
+
+public:
+    LongLivedScope() : saved(theScratch) { theScratch = 0; }
+    ~LongLivedScope() { theScratch = saved; }
+};
+
+#endif /* SCRATCH_H_ */
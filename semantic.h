@@ -0,0 +1,200 @@
+#ifndef SEMANTIC_H_
+#define SEMANTIC_H_
+
+#include <sstream>
+
+#include "parser.h"
+
+// SemanticCheck implemented as tree visitor
+// We visit only relevant nodes, i.e. VariableDeclaration and Identifier nodes
+// We keep a set of all names declared so far
+// The checks of single nodes are also called by the parser for the fused check,
+// in the same order as the traversal makes them
+class SemanticCheck : public ParseTreeVisitor
+{
+    bool hasErrors;
+    // where messages are kept instead of being printed, if not null
+    ostream *messages;
+    // how many messages were reported, each of them counted in errorCount
+    int reported;
+
+protected:
+    void setError()
+    {
+        hasErrors = true;
+    }
+
+    void report(int line, const string& message)
+    {
+        ++reported;
+        if (messages == 0)
+        {
+            error(line, message);
+            return;
+        }
+        ostream *output = theOutput;
+        theOutput = messages;
+        error(line, message);
+        theOutput = output;
+    }
+
+public:
+    explicit SemanticCheck(ostream *messages = 0)
+            : hasErrors(false),
+              messages(messages),
+              reported(0)
+    {
+    }
+
+    // After full traversal, we can use this function to see if there were any semantic errors
+    bool isErrorFree()
+    {
+        return !hasErrors;
+    }
+
+    int getReportCount() const
+    {
+        return reported;
+    }
+
+    // Semantic rule #4 - check if variable wasn't declared before
+    virtual void checkDeclaration(const VariableDeclaration *varDecl)
+    {
+        Identifier *identifier = varDecl->getIdentifier();
+        if (theContext->typeTable.find(identifier->getAtom()) != theContext->typeTable.end())
+        {
+            // variable was declared before
+            report(varDecl->getLineNumber(), "variable " + identifier->getName() + " was already declared");
+            hasErrors = true;
+        }
+        else
+        {
+            theContext->typeTable[identifier->getAtom()] = varDecl->GetType();
+        }
+    }
+
+    // the expression must have the type of the variable it's assigned to
+    void checkAssignment(const VariableAssignment *varAssign)
+    {
+        TypeTable::const_iterator it = theContext->typeTable.find(varAssign->getIdentifier()->getAtom());
+        if (it != theContext->typeTable.end() && varAssign->getLeft()->GetCheckedType() != it->second)
+        {
+            report(varAssign->getLeft()->getLineNumber(), "type error");
+            hasErrors = true;
+        }
+    }
+
+    // Semantic rule #2 - check if variable name was declared before use
+    void checkUse(const Identifier *identifier)
+    {
+        // we simply check if variable wasn't declared, if it was then it's name is in the set
+        if (theContext->typeTable.find(identifier->getAtom()) == theContext->typeTable.end())
+        {
+            // wasn't declared
+            report(identifier->getLineNumber(), "variable " + identifier->getName() + " is used before being declared");
+            hasErrors = true;
+        }
+    }
+
+    void checkOperation(const ParseTree *op)
+    {
+        if (op->GetCheckedType() == ERROR_TYPE)
+        {
+            report(op->getLineNumber(), "type error");
+        }
+    }
+
+    virtual bool beginVisit(const VariableDeclaration *varDecl)
+    {
+        checkDeclaration(varDecl);
+        // We return false here, because we don't want to go into VariableDeclaration children,
+        // as it only has one, Identifier, and we already handled that above
+        return false;
+    }
+
+    virtual bool beginVisit(const VariableAssignment *varAssign)
+    {
+        varAssign->getIdentifier()->accept(this);
+        varAssign->getLeft()->accept(this);
+        checkAssignment(varAssign);
+        return false;
+    }
+
+    virtual bool beginVisit(const PrintCommand *printCmd)
+    {
+        printCmd->getLeft()->accept(this);
+        return false;
+    }
+
+    // All identifiers that are not children of VariableDeclaration node
+    // must be uses of variable name, in expressions, assignments, etc.
+    virtual bool beginVisit(const Identifier *identifier)
+    {
+        checkUse(identifier);
+        return false;
+    }
+
+    virtual bool beginVisit(const Addition *add)
+    {
+        return beginVisitOperation(add);
+    }
+
+    virtual bool beginVisit(const Subtraction *sub)
+    {
+        return beginVisitOperation(sub);
+    }
+
+    virtual bool beginVisit(const Multiplication *mul)
+    {
+        return beginVisitOperation(mul);
+    }
+
+    virtual bool beginVisit(const Division *dvsn)
+    {
+        return beginVisitOperation(dvsn);
+    }
+
+    bool beginVisitOperation(const ParseTree *op)
+    {
+        op->getLeft()->accept(this);
+        op->getRight()->accept(this);
+        checkOperation(op);
+        return false;
+    }
+};
+
+// Runs the semantic check over a parsed program
+// Returns true if the program may be evaluated
+inline bool check(const ParseTree *tree)
+{
+    // Semantic check is performed by creating SemanticCheck object and accepting it by the tree
+    SemanticCheck semanticCheck;
+    tree->accept(&semanticCheck);
+    return semanticCheck.isErrorFree();
+}
+
+// Parses the program and checks it in the same pass, see theFusedCheck
+// The messages of the check are printed once the whole program parsed
+// without errors, so they are exactly those check() prints after Prog()
+// Returns what Prog() returns, sets checked if the program may be evaluated
+inline ParseTree* parseAndCheck(istream *in, bool& checked)
+{
+    std::ostringstream messages;
+    SemanticCheck semanticCheck(&messages);
+    theFusedCheck = &semanticCheck;
+    ParseTree *tree = Prog(in);
+    theFusedCheck = 0;
+
+    checked = false;
+    if (tree == 0 || hasParseErrors)
+    {
+        // a program with parse errors is never checked, only the parse errors count
+        errorCount -= semanticCheck.getReportCount();
+        return tree;
+    }
+    *theOutput << messages.str();
+    checked = semanticCheck.isErrorFree();
+    return tree;
+}
+
+#endif /* SEMANTIC_H_ */
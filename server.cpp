@@ -0,0 +1,359 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+#include "parser.h"
+#include "semantic.h"
+#include "cache.h"
+#include "protocol.h"
+#include "threadpool.h"
+#include "governor.h"
+
+// parserd: resident interpreter
+// Accepts programs over a Unix domain socket and runs each one on a pool thread
+// against its own Context, so requests never see each other's variables,
+// errors or output. Programs that compiled without any diagnostic are kept
+// in memory, keyed by the hash of their source, and reused by later requests
+// with the same source.
+
+// A compiled program with the table its names are interned in, and its source
+struct StoredProgram
+{
+    ParseTree	*tree;
+    Interner	*interner;
+    string		source;
+};
+
+// Compiled programs shared by all requests
+// Trees are never mutated by evaluation, so any number of threads may evaluate one at once
+class ProgramStore
+{
+    map<uint64_t, StoredProgram>	programs;
+    mutex							lock;
+    size_t							capacity;
+
+public:
+    explicit ProgramStore(size_t capacity) : capacity(capacity) {}
+
+    // Returns a program with a null tree if none is stored for source, whose hash is key
+    // Sources with the same hash are told apart by comparing them, so a client never runs
+    // another's program; only the first of them is kept
+    StoredProgram find(uint64_t key, const string& source)
+    {
+        lock_guard<mutex> guard(lock);
+        map<uint64_t, StoredProgram>::iterator it = programs.find(key);
+        if (it == programs.end() || it->second.source != source)
+        {
+            return StoredProgram{ 0, 0, string() };
+        }
+        return StoredProgram{ it->second.tree, it->second.interner, string() };
+    }
+
+    // Trees may be in use by other requests at any time, so entries are never evicted;
+    // once the store is full, new programs simply aren't kept
+    // Returns true if the store took the program, which the caller must then not free
+    bool add(uint64_t key, const StoredProgram& program)
+    {
+        lock_guard<mutex> guard(lock);
+        return programs.size() < capacity && programs.insert(make_pair(key, program)).second;
+    }
+};
+
+// Sends everything written to it back to the client as FRAME_OUTPUT frames
+class SocketOutput : public streambuf
+{
+    int		fd;
+    char	buffer[64 * 1024];
+
+protected:
+    virtual int_type overflow(int_type ch)
+    {
+        if (!send())
+        {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+public:
+    explicit SocketOutput(int fd) : fd(fd)
+    {
+        setp(buffer, buffer + sizeof(buffer));
+    }
+
+    // std::endl only syncs, which is a no-op here; output goes out a full buffer at a time
+    bool send()
+    {
+        size_t pending = pptr() - pbase();
+        setp(buffer, buffer + sizeof(buffer));
+        return pending == 0 || writeFrame(fd, FRAME_OUTPUT, buffer, pending);
+    }
+};
+
+// limits of every program, see governor.h
+static ResourceLimits programLimits;
+
+// Compiles (or finds) and evaluates one program against the current thread's context
+// Returns the exit status the command line interpreter would have returned
+static int run(const string& source, ProgramStore& store)
+{
+    uint64_t key = hashSource(source.data(), source.size());
+    StoredProgram program = store.find(key, source);
+    // a program the store didn't take belongs to this request alone, names and all,
+    // so the names of programs that aren't kept don't pile up in the daemon
+    std::unique_ptr<Interner> ownedNames;
+    std::unique_ptr<ParseTree> owned;
+    if (program.tree == 0)
+    {
+        program.interner = newInterner();
+        ownedNames.reset(program.interner);
+        theInterner = program.interner;
+        istringstream in(source);
+        program.tree = Prog(&in);
+        if (program.tree == 0 || hasParseErrors)
+        {
+            delete program.tree;
+            return 1;
+        }
+        if (!check(program.tree))
+        {
+            delete program.tree;
+            return 0;
+        }
+        program.source = source;
+        if (errorCount == 0 && store.add(key, program))
+        {
+            ownedNames.release();
+        }
+        else
+        {
+            owned.reset(program.tree);
+        }
+    }
+    theInterner = program.interner;
+    ResourceGovernor governor(programLimits);
+    theGovernor = programLimits.any() ? &governor : 0;
+    program.tree->Evaluate();
+    theGovernor = 0;
+    return 0;
+}
+
+// Reads the file name and the source of a request
+// Returns null, or why the request is refused if it is over the limits of protocol.h
+static const char* readRequest(int fd, string& name, string& source)
+{
+    uint32_t nameLength;
+    if (!readFully(fd, &nameLength, sizeof(nameLength)))
+    {
+        return 0;
+    }
+    // the lengths come from the client, so nothing is allocated before they are checked
+    if (nameLength > MAX_NAME_LENGTH)
+    {
+        return "FILE NAME TOO LONG";
+    }
+    name.resize(nameLength);
+    if (nameLength != 0 && !readFully(fd, &name[0], nameLength))
+    {
+        name.clear();
+        return 0;
+    }
+    char chunk[64 * 1024];
+    ssize_t n;
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0 || (n < 0 && errno == EINTR))
+    {
+        if (n > 0)
+        {
+            if ((size_t)n > MAX_SOURCE_BYTES - source.size())
+            {
+                return "PROGRAM TOO LARGE";
+            }
+            source.append(chunk, n);
+        }
+    }
+    return 0;
+}
+
+static void serve(int fd, ProgramStore& store, bool verbose)
+{
+    string name;
+    string source;
+    const char *refused = readRequest(fd, name, source);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Context context;
+    context.inputFileName = name.empty() ? 0 : &name;
+    SocketOutput output(fd);
+    ostream out(&output);
+
+    theContext = &context;
+    theOutput = &out;
+    lineNumber = 0;
+    hasParseErrors = false;
+    errorCount = 0;
+
+    StatusFrame status;
+    string failure;
+    if (refused != 0)
+    {
+        failure = refused;
+    }
+    else
+    {
+        // whatever one program runs into, the daemon goes on serving the others
+        try
+        {
+            status.exitStatus = run(source, store);
+        }
+        catch (std::exception& e)
+        {
+            failure = string("REQUEST FAILED: ") + e.what();
+        }
+        catch (...)
+        {
+            failure = "REQUEST FAILED";
+        }
+    }
+    out.flush();
+    output.send();
+
+    theContext = 0;
+    theOutput = 0;
+    theGovernor = 0;
+    theInterner = &theProcessInterner;
+
+    if (!failure.empty())
+    {
+        status.exitStatus = REQUEST_FAILED;
+        writeFrame(fd, FRAME_ERROR, failure.data(), failure.size());
+    }
+    status.serviceMicros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+    writeFrame(fd, FRAME_STATUS, &status, sizeof(status));
+    close(fd);
+    if (verbose)
+    {
+        cerr << (name.empty() ? "<stdin>" : name) << ": " << status.serviceMicros << " us";
+        if (!failure.empty())
+        {
+            cerr << ", " << failure;
+        }
+        cerr << endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    string socketPath = DEFAULT_SOCKET_PATH;
+    unsigned threads = 0;
+    size_t capacity = 1024;
+    bool verbose = false;
+    // -s path: socket to listen on
+    // -j n: number of worker threads, one per hardware thread by default
+    // -c n: maximum number of compiled programs kept in memory
+    // -v: log the service time of every request on stderr
+    // -m n, -M n, -t ms: limit the size of any value, the total size of the strings and the
+    // evaluation time of every program
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        string curArg = argv[arg];
+        if (curArg == "-v")
+        {
+            verbose = true;
+        }
+        else if ((curArg == "-m" || curArg == "-M" || curArg == "-t") && arg + 1 < argc)
+        {
+            unsigned long long value = strtoull(argv[++arg], 0, 10);
+            if (curArg == "-m")
+            {
+                programLimits.maxValueBytes = value;
+            }
+            else if (curArg == "-M")
+            {
+                programLimits.maxStringBytes = value;
+            }
+            else
+            {
+                programLimits.timeLimit = chrono::milliseconds(value);
+            }
+        }
+        else if ((curArg == "-s" || curArg == "-j" || curArg == "-c") && arg + 1 < argc)
+        {
+            string value = argv[++arg];
+            if (curArg == "-s")
+            {
+                socketPath = value;
+            }
+            else if (curArg == "-j")
+            {
+                threads = atoi(value.c_str());
+            }
+            else
+            {
+                capacity = atoi(value.c_str());
+            }
+        }
+        else
+        {
+            cerr << "usage: parserd [-s socket] [-j threads] [-c capacity] [-m bytes] [-M bytes] [-t ms] [-v]" << endl;
+            return 1;
+        }
+    }
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path))
+    {
+        cerr << socketPath << ": socket path too long" << endl;
+        return 1;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketPath.c_str());
+    if (listener < 0 ||
+        bind(listener, (sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(listener, SOMAXCONN) != 0)
+    {
+        cerr << socketPath << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    // a client that goes away mid-response must not take the server down
+    signal(SIGPIPE, SIG_IGN);
+
+    ProgramStore store(capacity);
+    ThreadPool pool(threads);
+    for (;;)
+    {
+        int fd = accept(listener, 0, 0);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            cerr << "accept: " << strerror(errno) << endl;
+            break;
+        }
+        pool.submit([fd, &store, verbose]() { serve(fd, store, verbose); });
+    }
+    close(listener);
+    return 1;
+}
@@ -0,0 +1,243 @@
+#include <functional>
+
+#include "share.h"
+
+thread_local NodeSharing *theNodeSharing = 0;
+
+// node kinds in NodeKey, the operations use their token type
+enum { SHARED_INTEGER = -1, SHARED_STRING = -2, SHARED_IDENTIFIER = -3 };
+
+struct SharedValue
+{
+    Value						value;
+    // how long the first evaluation took
+    std::chrono::nanoseconds	cost;
+};
+
+// counted by every thread evaluating the program, hence atomic
+static std::atomic<long> valueHits(0);
+static std::atomic<long long> nanosSaved(0);
+
+// marks a subtree evaluated once; it is timed and kept at its second evaluation,
+// as the first one is slowed down by everything that runs for the first time
+static const SharedValue evaluatedOnce = SharedValue();
+
+Value evaluateShared(const ParseTree *expr)
+{
+    const SharedValue *shared = expr->sharedValue.load(std::memory_order_acquire);
+    if (shared != 0 && shared != &evaluatedOnce)
+    {
+        valueHits.fetch_add(1, std::memory_order_relaxed);
+        nanosSaved.fetch_add(shared->cost.count(), std::memory_order_relaxed);
+        return shared->value;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Value val = expr->Evaluate();
+    // a failed evaluation printed its error, it has to print it again next time
+    if (val.type == ERROR_TYPE)
+    {
+        return val;
+    }
+    if (shared == 0)
+    {
+        expr->sharedValue.compare_exchange_strong(shared, &evaluatedOnce, std::memory_order_acq_rel);
+        return val;
+    }
+    SharedValue *created = new SharedValue;
+    {
+        // the value is kept for later statements, so it can't stay on scratch
+        LongLivedScope kept;
+        created->value = val;
+    }
+    created->cost = std::chrono::steady_clock::now() - start;
+    // another thread may have evaluated it at the same time
+    if (!expr->sharedValue.compare_exchange_strong(shared, created, std::memory_order_acq_rel))
+    {
+        delete created;
+    }
+    return val;
+}
+
+size_t NodeSharing::NodeKeyHash::operator()(const NodeKey& key) const
+{
+    size_t hash = std::hash<int>()(key.kind);
+    hash = hash * 31 + std::hash<int64_t>()(key.value);
+    hash = hash * 31 + std::hash<const void*>()(key.left);
+    hash = hash * 31 + std::hash<const void*>()(key.right);
+    return hash;
+}
+
+NodeSharing::NodeSharing() : statementLines(0)
+{
+}
+
+NodeSharing::~NodeSharing()
+{
+    finish();
+}
+
+void NodeSharing::beginStatement()
+{
+    // every node of the statement is listed until it ends
+    if (statementLines == 0)
+    {
+        statementLines = new LineTable;
+    }
+    statementLines->lines.clear();
+    theLineTable = statementLines;
+}
+
+const LineTable* NodeSharing::endStatement()
+{
+    // Most nodes are on the most common line, only the others are listed
+    theLineTable = 0;
+    LineTable *lines = statementLines;
+    statementLines = 0;
+    std::unordered_map<int, int> nodesOnLine;
+    for (std::unordered_map<const ParseTree*, int>::iterator it = lines->lines.begin(); it != lines->lines.end(); ++it)
+    {
+        if (++nodesOnLine[it->second] > nodesOnLine[lines->line])
+        {
+            lines->line = it->second;
+        }
+    }
+    for (std::unordered_map<const ParseTree*, int>::iterator it = lines->lines.begin(); it != lines->lines.end(); )
+    {
+        if (it->second == lines->line)
+        {
+            it = lines->lines.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    if (lines->lines.empty())
+    {
+        std::unordered_map<const ParseTree*, int>().swap(lines->lines);
+    }
+    sharing.lineTableBytes += sizeof(LineTable) + lines->lines.bucket_count() * sizeof(void*) +
+                              lines->lines.size() * (sizeof(void*) + sizeof(std::pair<const ParseTree*, int>));
+    return lines;
+}
+
+// Returns the node built before for key, or null if there is none or it can't be used here
+ParseTree* NodeSharing::find(const NodeKey& key, int line)
+{
+    ++sharing.nodesRequested;
+    std::unordered_map<NodeKey, ParseTree*, NodeKeyHash>::iterator it = nodes.find(key);
+    if (it == nodes.end())
+    {
+        return 0;
+    }
+    ParseTree *node = it->second;
+    // the statement has a single line for each of its nodes
+    std::unordered_map<const ParseTree*, int>::iterator seen = statementLines->lines.find(node);
+    if (seen != statementLines->lines.end() && seen->second != line)
+    {
+        return 0;
+    }
+    // the type annotated where it was built must hold here too
+    if (theFusedCheck != 0 && node->GetCheckedType() != node->GetType())
+    {
+        return 0;
+    }
+
+    statementLines->lines[node] = line;
+    node->setShared();
+    sharing.bytesSaved += key.kind == SHARED_INTEGER ? sizeof(IntegerConstant) :
+                          key.kind == SHARED_STRING ? sizeof(StringConstant) :
+                          key.kind == SHARED_IDENTIFIER ? sizeof(Identifier) : sizeof(Addition);
+    if (key.left != 0 && constant[node])
+    {
+        node->setValueShared();
+    }
+    return node;
+}
+
+ParseTree* NodeSharing::add(const NodeKey& key, ParseTree *node, int line, bool isConstant)
+{
+    ++sharing.nodesAllocated;
+    nodes.insert(std::make_pair(key, node));
+    constant[node] = isConstant;
+    statementLines->lines[node] = line;
+    return node;
+}
+
+ParseTree* NodeSharing::integerConstant(const Token& token)
+{
+    NodeKey key = { SHARED_INTEGER, token.GetIntValue(), 0, 0 };
+    if (ParseTree *node = find(key, token.GetLinenum()))
+    {
+        return node;
+    }
+    return add(key, new IntegerConstant(token.GetLinenum(), (int)key.value), token.GetLinenum(), true);
+}
+
+ParseTree* NodeSharing::stringConstant(const Token& token)
+{
+    NodeKey key = { SHARED_STRING, token.GetAtom(), 0, 0 };
+    if (ParseTree *node = find(key, token.GetLinenum()))
+    {
+        return node;
+    }
+    return add(key, new StringConstant(token), token.GetLinenum(), true);
+}
+
+Identifier* NodeSharing::identifier(const Token& token)
+{
+    NodeKey key = { SHARED_IDENTIFIER, token.GetAtom(), 0, 0 };
+    if (ParseTree *node = find(key, token.GetLinenum()))
+    {
+        return static_cast<Identifier*>(node);
+    }
+    return static_cast<Identifier*>(add(key, new Identifier(token), token.GetLinenum(), false));
+}
+
+ParseTree* NodeSharing::operation(const Token& op, ParseTree *left, ParseTree *right)
+{
+    NodeKey key = { op.GetTokenType(), 0, left, right };
+    int line = op.GetLinenum();
+    if (ParseTree *node = find(key, line))
+    {
+        return node;
+    }
+    ParseTree *node;
+    switch (op.GetTokenType())
+    {
+        case T_PLUS:
+            node = new Addition(line, left, right);
+            break;
+        case T_MINUS:
+            node = new Subtraction(line, left, right);
+            break;
+        case T_STAR:
+            node = new Multiplication(line, left, right);
+            break;
+        default:
+            node = new Division(line, left, right);
+            break;
+    }
+    return add(key, node, line, constant[left] && constant[right]);
+}
+
+void NodeSharing::finish()
+{
+    if (theLineTable == statementLines)
+    {
+        theLineTable = 0;
+    }
+    delete statementLines;
+    statementLines = 0;
+    std::unordered_map<NodeKey, ParseTree*, NodeKeyHash>().swap(nodes);
+    std::unordered_map<const ParseTree*, bool>().swap(constant);
+}
+
+ShareReport NodeSharing::report() const
+{
+    ShareReport result = sharing;
+    result.valueHits = valueHits.load();
+    result.timeSaved = std::chrono::nanoseconds(nanosSaved.load());
+    return result;
+}
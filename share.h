@@ -0,0 +1,102 @@
+#ifndef SHARE_H_
+#define SHARE_H_
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using std::string;
+
+#include "parser.h"
+
+// Hash-consing of expression nodes
+//
+// While a NodeSharing is installed as theNodeSharing, Expr(), Term() and
+// Primary() get their nodes from it instead of allocating them. A node whose
+// kind, value and children equal those of a node built before is that node,
+// so structurally identical subtrees become one shared subtree and the program
+// a DAG. A node keeps the line it was first built on; every statement holds a
+// LineTable with the lines its shared nodes are on, which getLineNumber()
+// consults, so all diagnostics keep their lines. A node is not
+// shared within one statement on two different lines, nor, under the fused
+// check, where the type it was annotated with differs.
+//
+// A shared subtree without variables is evaluated once; later evaluations
+// reuse its value, unless evaluating it failed.
+
+struct ShareReport
+{
+    // expression nodes the parser asked for, and those that had to be allocated
+    long nodesRequested;
+    long nodesAllocated;
+    // memory of the nodes that weren't allocated, and of the line tables
+    long bytesSaved;
+    long lineTableBytes;
+    // evaluations of shared constant subtrees answered from their kept value,
+    // and the time they took when they were evaluated for the first time
+    long valueHits;
+    std::chrono::nanoseconds timeSaved;
+
+    ShareReport() : nodesRequested(0), nodesAllocated(0), bytesSaved(0), lineTableBytes(0), valueHits(0), timeSaved(0) {}
+};
+
+class NodeSharing
+{
+    struct NodeKey
+    {
+        int					kind;
+        // the integer, or the atom of the string or name
+        int64_t				value;
+        const ParseTree		*left;
+        const ParseTree		*right;
+
+        bool operator==(const NodeKey& other) const
+        {
+            return kind == other.kind && value == other.value && left == other.left && right == other.right;
+        }
+    };
+
+    struct NodeKeyHash
+    {
+        size_t operator()(const NodeKey& key) const;
+    };
+
+    std::unordered_map<NodeKey, ParseTree*, NodeKeyHash>	nodes;
+    // lines of the nodes of the statement being parsed
+    LineTable				*statementLines;
+    // nodes without variables below them
+    std::unordered_map<const ParseTree*, bool>				constant;
+    ShareReport				sharing;
+
+    NodeSharing(const NodeSharing&);
+    NodeSharing& operator=(const NodeSharing&);
+
+    ParseTree* find(const NodeKey& key, int line);
+    ParseTree* add(const NodeKey& key, ParseTree *node, int line, bool isConstant);
+
+public:
+    NodeSharing();
+    ~NodeSharing();
+
+    // called by the parser around every statement
+    void beginStatement();
+    // Returns the line table the statement keeps
+    const LineTable* endStatement();
+
+    ParseTree* integerConstant(const Token& token);
+    ParseTree* stringConstant(const Token& token);
+    Identifier* identifier(const Token& token);
+    // op is the operator token, T_PLUS, T_MINUS, T_STAR or T_SLASH
+    ParseTree* operation(const Token& op, ParseTree *left, ParseTree *right);
+
+    // Drops the tables only needed while parsing
+    void finish();
+
+    // Statistics, including the values reused by evaluations so far
+    ShareReport report() const;
+};
+
+// the hash-consing the parser uses on this thread, null if there is none
+extern thread_local NodeSharing *theNodeSharing;
+
+#endif /* SHARE_H_ */
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+using std::vector;
+
+#include <unistd.h>
+
+#include "cache.h"
+#include "snapshot.h"
+
+// On-disk layout: SnapshotHeader, variableCount SnapshotVariable records in
+// the order of their names, outputSize bytes the prelude printed, then
+// poolSize bytes of string pool.
+// All integers are in host byte order, like those of the program cache.
+struct SnapshotHeader
+{
+    char		magic[4];
+    uint32_t	version;
+    uint64_t	preludeHash;
+    uint32_t	variableCount;
+    uint32_t	reserved;
+    uint64_t	outputSize;
+    uint64_t	poolSize;
+};
+
+struct SnapshotVariable
+{
+    uint64_t	nameOffset;
+    uint64_t	valueOffset;
+    uint32_t	nameLength;
+    // the declared type; the value of a string variable is in the pool,
+    // that of an integer in intValue
+    int32_t		type;
+    int32_t		intValue;
+    // 0 for a variable without storage yet, as no statement leaves one
+    uint32_t	hasValue;
+    uint64_t	valueLength;
+};
+
+static const char snapshotMagic[4] = { 'P', 'R', 'S', 'S' };
+
+static bool inPool(uint64_t offset, uint64_t length, uint64_t poolSize)
+{
+    return offset <= poolSize && length <= poolSize - offset;
+}
+
+bool loadSnapshot(const string& path, uint64_t preludeHash, ostream& out, const ResourceGovernor *governor)
+{
+    MappedFile file;
+    if (!file.open(path) || file.getSize() < sizeof(SnapshotHeader))
+    {
+        return false;
+    }
+    const char *image = file.getData();
+    const SnapshotHeader *header = (const SnapshotHeader*)image;
+    if (memcmp(header->magic, snapshotMagic, sizeof(snapshotMagic)) != 0 ||
+        header->version != SNAPSHOT_FORMAT_VERSION ||
+        header->preludeHash != preludeHash)
+    {
+        return false;
+    }
+    uint64_t available = file.getSize() - sizeof(SnapshotHeader);
+    uint64_t recordBytes = (uint64_t)header->variableCount * sizeof(SnapshotVariable);
+    if (recordBytes > available || header->outputSize > available - recordBytes ||
+        header->poolSize != available - recordBytes - header->outputSize)
+    {
+        return false;
+    }
+    const SnapshotVariable *variables = (const SnapshotVariable*)(image + sizeof(SnapshotHeader));
+    const char *output = (const char*)(variables + header->variableCount);
+    const char *pool = output + header->outputSize;
+
+    // everything is decoded before the context is touched
+    vector<Atom> names;
+    names.reserve(header->variableCount);
+    // the strings restored so far, which the limit on string memory covers with the next one
+    uint64_t held = 0;
+    for (uint32_t i = 0; i < header->variableCount; ++i)
+    {
+        const SnapshotVariable& variable = variables[i];
+        if (!inPool(variable.nameOffset, variable.nameLength, header->poolSize) ||
+            (variable.type != INT_TYPE && variable.type != STRING_TYPE) ||
+            (variable.type == STRING_TYPE && !inPool(variable.valueOffset, variable.valueLength, header->poolSize)))
+        {
+            return false;
+        }
+        if (governor != 0 && variable.type == STRING_TYPE && variable.hasValue != 0)
+        {
+            if (governor->admit(variable.valueLength, held) != 0)
+            {
+                return false;
+            }
+            held += variable.valueLength;
+        }
+        names.push_back(theInterner->intern(std::string_view(pool + variable.nameOffset, variable.nameLength)));
+    }
+
+    MemoryScope tables(MEM_TABLES);
+    theContext->typeTable.reserve(theContext->typeTable.size() + names.size());
+    theContext->symbolTable.reserve(theContext->symbolTable.size() + names.size());
+    for (uint32_t i = 0; i < header->variableCount; ++i)
+    {
+        const SnapshotVariable& variable = variables[i];
+        theContext->typeTable[names[i]] = (TypeForNode)variable.type;
+        if (variable.hasValue == 0)
+        {
+            continue;
+        }
+        theContext->symbolTable[names[i]] =
+                variable.type == INT_TYPE ? Value::Integer(variable.intValue)
+                                          : Value::String(std::string_view(pool + variable.valueOffset, variable.valueLength));
+    }
+    out.write(output, header->outputSize);
+    return true;
+}
+
+bool saveSnapshot(const string& path, uint64_t preludeHash, const string& output)
+{
+    // in the order of their names, so the same prelude always gives the same file
+    vector<std::pair<std::string_view, Atom> > names;
+    for (TypeTable::const_iterator it = theContext->typeTable.begin(); it != theContext->typeTable.end(); ++it)
+    {
+        names.push_back(std::make_pair(theInterner->spelling(it->first), it->first));
+    }
+    std::sort(names.begin(), names.end());
+
+    vector<SnapshotVariable> variables;
+    string pool;
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        SnapshotVariable variable;
+        memset(&variable, 0, sizeof(variable));
+        variable.nameOffset = pool.size();
+        variable.nameLength = names[i].first.size();
+        pool += names[i].first;
+        variable.type = theContext->typeTable.find(names[i].second)->second;
+        SymbolTable::const_iterator value = theContext->symbolTable.find(names[i].second);
+        if (value != theContext->symbolTable.end())
+        {
+            variable.hasValue = 1;
+            variable.intValue = value->second.type == INT_TYPE ? value->second.intValue : 0;
+            if (value->second.type == STRING_TYPE)
+            {
+                variable.valueOffset = pool.size();
+                variable.valueLength = value->second.stringValue.size();
+                pool.append(value->second.stringValue.data(), value->second.stringValue.size());
+            }
+        }
+        variables.push_back(variable);
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = SNAPSHOT_FORMAT_VERSION;
+    header.preludeHash = preludeHash;
+    header.variableCount = variables.size();
+    header.outputSize = output.size();
+    header.poolSize = pool.size();
+
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".tmp%ld", (long)getpid());
+    string tempPath = path + suffix;
+
+    FILE *f = fopen(tempPath.c_str(), "wb");
+    if (f == 0)
+    {
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    if (ok && !variables.empty())
+    {
+        ok = fwrite(&variables[0], sizeof(SnapshotVariable), variables.size(), f) == variables.size();
+    }
+    if (ok && !output.empty())
+    {
+        ok = fwrite(output.data(), 1, output.size(), f) == output.size();
+    }
+    if (ok && !pool.empty())
+    {
+        ok = fwrite(pool.data(), 1, pool.size(), f) == pool.size();
+    }
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <string>
+using std::string;
+
+#include <stdint.h>
+
+#include "parser.h"
+
+// Snapshot of the interpreter state a prelude leaves, for a warm start
+//
+// A prelude is a program run before the main one on the same context: the
+// main program sees the variables it declared, with the values it left in
+// them. After a prelude parsed, checked and ran without any diagnostics, its
+// variables are written to a snapshot file: a header with a version tag and
+// the hash of the prelude's source, a record of the name, type and value of
+// every variable, what the prelude printed, and a pool of names and strings.
+// A later run of the same prelude maps the snapshot with a single mmap, puts
+// the variables back into the symbol and type tables and prints the output
+// again, without lexing, checking or evaluating the prelude at all.
+
+// bump whenever the layout of the snapshot or the meaning of a record changes
+const uint32_t SNAPSHOT_FORMAT_VERSION = 1;
+
+// Restores the variables of the snapshot at path into theContext and writes
+// the prelude's output to out
+// Returns false, leaving both untouched, if the file is missing, was written
+// by another format version or for another prelude source, is damaged, or
+// holds a string governor wouldn't admit, alone or with the strings before it
+extern bool loadSnapshot(const string& path, uint64_t preludeHash, ostream& out,
+                         const ResourceGovernor *governor = 0);
+
+// Writes the variables of theContext and the output of the prelude with the
+// given source hash to path
+// The snapshot is written to a temporary file and renamed into place, so
+// concurrent readers never see a partial one
+extern bool saveSnapshot(const string& path, uint64_t preludeHash, const string& output);
+
+#endif /* SNAPSHOT_H_ */
@@ -0,0 +1,372 @@
+#include <malloc.h>
+#include <time.h>
+
+#include <iomanip>
+
+#include "stats.h"
+
+thread_local RunStats *theStats = 0;
+thread_local MemoryReport *theMemoryReport = 0;
+thread_local PerfReport *thePerfReport = 0;
+
+const char * const phaseNames[PHASE_COUNT] = { "load", "parse", "check", "dse", "evaluate" };
+const char * const nodeKindNames[NODE_KIND_COUNT] = {
+        "StatementList", "Addition", "Subtraction", "Multiplication", "Division", "PrintCommand",
+        "VariableAssignment", "VariableDeclaration", "Identifier", "IntegerConstant", "StringConstant"
+};
+
+static std::chrono::nanoseconds processCpuTime()
+{
+    struct timespec now;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now) != 0)
+    {
+        return std::chrono::nanoseconds(0);
+    }
+    return std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec);
+}
+
+PhaseTimer::PhaseTimer(Phase phase)
+        : stats(theStats), memory(theMemoryReport), perf(thePerfReport), phase(phase), cpuStart(0)
+{
+    if (memory != 0)
+    {
+        // what evaluation allocates outside of the variables is values
+        beginMemoryPhase(phase == PHASE_EVALUATE ? MEM_VALUES : MEM_OTHER);
+    }
+    if (stats != 0)
+    {
+        wallStart = std::chrono::steady_clock::now();
+        cpuStart = processCpuTime();
+    }
+    if (perf != 0)
+    {
+        perf->counters.read(perfStart);
+    }
+}
+
+PhaseTimer::~PhaseTimer()
+{
+    if (stats != 0)
+    {
+        PhaseTime& time = stats->phases[phase];
+        time.ran = true;
+        time.wall += std::chrono::steady_clock::now() - wallStart;
+        time.cpu += processCpuTime() - cpuStart;
+    }
+    if (perf != 0)
+    {
+        uint64_t counts[PERF_EVENT_COUNT];
+        perf->counters.read(counts);
+        perf->ran[phase] = true;
+        for (int event = 0; event < PERF_EVENT_COUNT; ++event)
+        {
+            perf->counts[phase][event] += counts[event] - perfStart[event];
+        }
+    }
+    if (memory != 0)
+    {
+        memory->ran[phase] = true;
+        memory->phases[phase] = endMemoryPhase();
+    }
+}
+
+CountingBuffer::int_type CountingBuffer::overflow(int_type ch)
+{
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+    {
+        return traits_type::not_eof(ch);
+    }
+    ++count;
+    return target->sputc(traits_type::to_char_type(ch));
+}
+
+std::streamsize CountingBuffer::xsputn(const char *data, std::streamsize size)
+{
+    std::streamsize written = target->sputn(data, size);
+    count += written;
+    return written;
+}
+
+int CountingBuffer::sync()
+{
+    return target->pubsync();
+}
+
+bool NodeKindVisitor::visit(const ParseTree *node, NodeKind kind)
+{
+    // only nodes hash-consing shared can be reached twice
+    if (node->isShared() && !seen.insert(node).second)
+    {
+        return false;
+    }
+    visitNode(node, kind);
+    return true;
+}
+
+bool NodeKindVisitor::beginVisit(const VariableAssignment *varAssign)
+{
+    visit((const ParseTree*)varAssign->getIdentifier(), NODE_IDENTIFIER);
+    return visit((const ParseTree*)varAssign, NODE_ASSIGNMENT);
+}
+
+bool NodeKindVisitor::beginVisit(const VariableDeclaration *varDecl)
+{
+    visit((const ParseTree*)varDecl->getIdentifier(), NODE_IDENTIFIER);
+    return visit((const ParseTree*)varDecl, NODE_DECLARATION);
+}
+
+class NodeCounter : public NodeKindVisitor
+{
+    RunStats& stats;
+
+protected:
+    virtual void visitNode(const ParseTree *, NodeKind kind) { ++stats.nodes[kind]; }
+
+public:
+    explicit NodeCounter(RunStats& stats) : stats(stats) {}
+};
+
+RunStats::RunStats()
+        : tokens(0), declared(0), variables(0), interned(0), bytesPrinted(0)
+{
+    for (int kind = 0; kind < NODE_KIND_COUNT; ++kind)
+    {
+        nodes[kind] = 0;
+    }
+}
+
+long RunStats::totalNodes() const
+{
+    long total = 0;
+    for (int kind = 0; kind < NODE_KIND_COUNT; ++kind)
+    {
+        total += nodes[kind];
+    }
+    return total;
+}
+
+double RunStats::tokensPerSecond() const
+{
+    double seconds = std::chrono::duration<double>(phases[PHASE_PARSE].wall).count();
+    return seconds > 0 ? tokens / seconds : 0;
+}
+
+void RunStats::countNodes(const ParseTree *program)
+{
+    if (program != 0)
+    {
+        NodeCounter counter(*this);
+        program->accept(&counter);
+    }
+}
+
+static double microseconds(std::chrono::nanoseconds time)
+{
+    return std::chrono::duration<double, std::micro>(time).count();
+}
+
+void RunStats::print(std::ostream& out) const
+{
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(0);
+    for (int phase = 0; phase < PHASE_COUNT; ++phase)
+    {
+        if (phases[phase].ran)
+        {
+            out << "stats: " << phaseNames[phase] << " " << microseconds(phases[phase].wall) << " us wall, "
+                << microseconds(phases[phase].cpu) << " us cpu" << std::endl;
+        }
+    }
+    out << "stats: " << tokens << " tokens, " << tokensPerSecond() << " tokens/s" << std::endl;
+    out << "stats: " << totalNodes() << " nodes";
+    const char *separator = ": ";
+    for (int kind = 0; kind < NODE_KIND_COUNT; ++kind)
+    {
+        if (nodes[kind] != 0)
+        {
+            out << separator << nodeKindNames[kind] << " " << nodes[kind];
+            separator = ", ";
+        }
+    }
+    out << std::endl;
+    out << "stats: " << declared << " variables declared, " << variables << " set, "
+        << interned << " names and strings interned" << std::endl;
+    out << "stats: " << bytesPrinted << " bytes printed" << std::endl;
+    out.flags(flags);
+}
+
+void RunStats::printJson(std::ostream& out) const
+{
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(0);
+    out << "{\n  \"phases\": {";
+    bool first = true;
+    for (int phase = 0; phase < PHASE_COUNT; ++phase)
+    {
+        if (phases[phase].ran)
+        {
+            out << (first ? "\n" : ",\n") << "    \"" << phaseNames[phase] << "\": { \"wall_us\": "
+                << microseconds(phases[phase].wall) << ", \"cpu_us\": " << microseconds(phases[phase].cpu) << " }";
+            first = false;
+        }
+    }
+    out << "\n  },\n  \"tokens\": " << tokens << ",\n  \"tokens_per_second\": " << tokensPerSecond()
+        << ",\n  \"nodes\": {\n    \"total\": " << totalNodes();
+    for (int kind = 0; kind < NODE_KIND_COUNT; ++kind)
+    {
+        out << ",\n    \"" << nodeKindNames[kind] << "\": " << nodes[kind];
+    }
+    out << "\n  },\n  \"variables_declared\": " << declared << ",\n  \"variables_set\": " << variables
+        << ",\n  \"interned\": " << interned << ",\n  \"bytes_printed\": " << bytesPrinted << "\n}" << std::endl;
+    out.flags(flags);
+}
+
+class NodeMemory : public NodeKindVisitor
+{
+    MemoryReport& report;
+
+protected:
+    virtual void visitNode(const ParseTree *node, NodeKind kind)
+    {
+        ++report.nodes[kind];
+        report.nodeBytes[kind] += malloc_usable_size((void*)node);
+    }
+
+public:
+    explicit NodeMemory(MemoryReport& report) : report(report) {}
+};
+
+MemoryReport::MemoryReport()
+{
+    for (int phase = 0; phase < PHASE_COUNT; ++phase)
+    {
+        ran[phase] = false;
+    }
+    for (int kind = 0; kind < NODE_KIND_COUNT; ++kind)
+    {
+        nodes[kind] = 0;
+        nodeBytes[kind] = 0;
+    }
+}
+
+void MemoryReport::countNodes(const ParseTree *program)
+{
+    if (program != 0)
+    {
+        NodeMemory counter(*this);
+        program->accept(&counter);
+    }
+}
+
+static void printCategories(std::ostream& out, const MemoryUsage& usage)
+{
+    for (int category = 0; category < MEM_CATEGORY_COUNT; ++category)
+    {
+        out << (category == 0 ? "" : ", ") << memoryCategoryNames[category] << " " << usage.live[category]
+            << " (peak " << usage.peak[category] << ")";
+    }
+}
+
+void MemoryReport::print(std::ostream& out) const
+{
+    for (int phase = 0; phase < PHASE_COUNT; ++phase)
+    {
+        if (ran[phase])
+        {
+            out << "memory: " << phaseNames[phase] << " peak " << phases[phase].peakTotal << " bytes, "
+                << phases[phase].liveTotal << " live at its end: ";
+            printCategories(out, phases[phase]);
+            out << std::endl;
+        }
+    }
+    MemoryUsage usage = memoryUsage();
+    out << "memory: overall peak " << usage.peakTotal << " bytes, " << usage.liveTotal << " live now: ";
+    printCategories(out, usage);
+    out << std::endl;
+
+    long total = 0;
+    for (int kind = 0; kind < NODE_KIND_COUNT; ++kind)
+    {
+        total += nodeBytes[kind];
+    }
+    out << "memory: nodes " << total << " bytes";
+    const char *separator = ": ";
+    for (int kind = 0; kind < NODE_KIND_COUNT; ++kind)
+    {
+        if (nodes[kind] != 0)
+        {
+            out << separator << nodeKindNames[kind] << " " << nodeBytes[kind] << " in " << nodes[kind];
+            separator = ", ";
+        }
+    }
+    out << std::endl;
+}
+
+PerfReport::PerfReport()
+{
+    for (int phase = 0; phase < PHASE_COUNT; ++phase)
+    {
+        ran[phase] = false;
+        for (int event = 0; event < PERF_EVENT_COUNT; ++event)
+        {
+            counts[phase][event] = 0;
+        }
+    }
+}
+
+void PerfReport::print(std::ostream& out, const RunStats& stats) const
+{
+    if (!counters.available())
+    {
+        out << "perf: no hardware counters available (" << counters.getFailure() << ")" << std::endl;
+        return;
+    }
+    std::ios::fmtflags flags = out.flags();
+    for (int phase = 0; phase < PHASE_COUNT; ++phase)
+    {
+        if (!ran[phase])
+        {
+            continue;
+        }
+        const uint64_t *count = counts[phase];
+        out << "perf: " << phaseNames[phase];
+        const char *separator = " ";
+        for (int event = 0; event < PERF_EVENT_COUNT; ++event)
+        {
+            if (counters.available((PerfEvent)event))
+            {
+                out << separator << count[event] << " " << perfEventNames[event];
+                separator = ", ";
+            }
+        }
+        out << std::fixed << std::setprecision(2);
+        if (counters.available(PERF_CYCLES) && counters.available(PERF_INSTRUCTIONS) && count[PERF_CYCLES] != 0)
+        {
+            out << "; IPC " << (double)count[PERF_INSTRUCTIONS] / count[PERF_CYCLES];
+        }
+        long units = phase == PHASE_PARSE ? stats.tokens : stats.totalNodes();
+        if (units > 0)
+        {
+            out << "; per " << (phase == PHASE_PARSE ? "token" : "node");
+            separator = " ";
+            for (int event = PERF_BRANCH_MISSES; event < PERF_EVENT_COUNT; ++event)
+            {
+                if (counters.available((PerfEvent)event))
+                {
+                    out << separator << (double)count[event] / units << " " << perfEventNames[event];
+                    separator = ", ";
+                }
+            }
+        }
+        out.flags(flags);
+        out << std::endl;
+    }
+    for (int event = 0; event < PERF_EVENT_COUNT; ++event)
+    {
+        if (!counters.available((PerfEvent)event))
+        {
+            out << "perf: " << counters.getFailure() << "; unavailable counters left out" << std::endl;
+            break;
+        }
+    }
+}
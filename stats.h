@@ -0,0 +1,176 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <chrono>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <unordered_set>
+using std::string;
+
+#include <stdint.h>
+
+#include "parser.h"
+#include "memory.h"
+#include "perfcount.h"
+
+// Run statistics for --stats
+//
+// While a RunStats is installed as theStats, the parser counts the tokens it
+// lexes and PhaseTimer adds the wall and CPU time of every phase to it. With
+// no RunStats installed, a PhaseTimer does nothing and the parser only tests
+// the pointer. Everything else is collected once, after the phase it
+// describes: nodes are counted by walking the finished tree, symbols from the
+// tables, and printed bytes by a counting buffer in front of standard output.
+
+enum Phase { PHASE_LOAD, PHASE_PARSE, PHASE_CHECK, PHASE_DSE, PHASE_EVALUATE, PHASE_COUNT };
+
+// kinds of ParseTree nodes, in the order of ParseTreeVisitor
+enum NodeKind { NODE_STATEMENT_LIST, NODE_ADDITION, NODE_SUBTRACTION, NODE_MULTIPLICATION, NODE_DIVISION,
+                NODE_PRINT, NODE_ASSIGNMENT, NODE_DECLARATION, NODE_IDENTIFIER, NODE_INTEGER, NODE_STRING,
+                NODE_KIND_COUNT };
+
+extern const char * const phaseNames[PHASE_COUNT];
+extern const char * const nodeKindNames[NODE_KIND_COUNT];
+
+// Visits every distinct node of a tree once, however many statements share it,
+// and hands it to visitNode() with its kind
+// Declarations and assignments don't visit their identifiers, so this does
+class NodeKindVisitor : public ParseTreeVisitor
+{
+    std::unordered_set<const ParseTree*> seen;
+
+    bool visit(const ParseTree *node, NodeKind kind);
+
+protected:
+    virtual void visitNode(const ParseTree *node, NodeKind kind) = 0;
+
+public:
+    virtual bool beginVisit(const StatementList *stmts) { return visit((const ParseTree*)stmts, NODE_STATEMENT_LIST); }
+    virtual bool beginVisit(const Addition *add) { return visit((const ParseTree*)add, NODE_ADDITION); }
+    virtual bool beginVisit(const Subtraction *sub) { return visit((const ParseTree*)sub, NODE_SUBTRACTION); }
+    virtual bool beginVisit(const Multiplication *mul) { return visit((const ParseTree*)mul, NODE_MULTIPLICATION); }
+    virtual bool beginVisit(const Division *div) { return visit((const ParseTree*)div, NODE_DIVISION); }
+    virtual bool beginVisit(const PrintCommand *print) { return visit((const ParseTree*)print, NODE_PRINT); }
+    virtual bool beginVisit(const VariableAssignment *varAssign);
+    virtual bool beginVisit(const VariableDeclaration *varDecl);
+    virtual bool beginVisit(const Identifier *id) { return visit((const ParseTree*)id, NODE_IDENTIFIER); }
+    virtual bool beginVisit(const IntegerConstant *intConst) { return visit((const ParseTree*)intConst, NODE_INTEGER); }
+    virtual bool beginVisit(const StringConstant *strConst) { return visit((const ParseTree*)strConst, NODE_STRING); }
+};
+
+struct PhaseTime
+{
+    bool ran;
+    std::chrono::nanoseconds wall;
+    // CPU time of the whole process, so it includes the threads of -j
+    std::chrono::nanoseconds cpu;
+
+    PhaseTime() : ran(false), wall(0), cpu(0) {}
+};
+
+struct RunStats
+{
+    PhaseTime phases[PHASE_COUNT];
+    // tokens the parser read from the lexer
+    long tokens;
+    // distinct nodes of the program tree, by kind
+    long nodes[NODE_KIND_COUNT];
+    // declared variables, variables holding a value at the end, and names and strings interned
+    long declared;
+    long variables;
+    long interned;
+    // bytes written to standard output, messages included
+    long bytesPrinted;
+
+    RunStats();
+
+    long totalNodes() const;
+    // tokens per second of parsing, or 0 if nothing was parsed
+    double tokensPerSecond() const;
+
+    // Counts the distinct nodes of program
+    void countNodes(const ParseTree *program);
+
+    void print(std::ostream& out) const;
+    void printJson(std::ostream& out) const;
+};
+
+// statistics being collected on this thread, or null
+extern thread_local RunStats *theStats;
+
+// Memory used by every phase and by the nodes of the program, for --memory
+// See memory.h; the phases are measured by PhaseTimer
+struct MemoryReport
+{
+    bool ran[PHASE_COUNT];
+    MemoryUsage phases[PHASE_COUNT];
+    // distinct nodes of the program tree, and the bytes malloc gave them, by kind
+    long nodes[NODE_KIND_COUNT];
+    long nodeBytes[NODE_KIND_COUNT];
+
+    MemoryReport();
+
+    void countNodes(const ParseTree *program);
+    void print(std::ostream& out) const;
+};
+
+// memory report being collected on this thread, or null
+extern thread_local MemoryReport *theMemoryReport;
+
+// Hardware counts of every phase, for --perf
+// The phases are measured by PhaseTimer; misses are reported per token of the
+// parse and per node of the other phases, from the counts of a RunStats
+struct PerfReport
+{
+    PerfCounters counters;
+    bool ran[PHASE_COUNT];
+    uint64_t counts[PHASE_COUNT][PERF_EVENT_COUNT];
+
+    PerfReport();
+
+    void print(std::ostream& out, const RunStats& stats) const;
+};
+
+// hardware counts being collected on this thread, or null
+extern thread_local PerfReport *thePerfReport;
+
+// Adds the time from its construction to its destruction to a phase of theStats,
+// and measures the memory and hardware counts of the phase for theMemoryReport
+// and thePerfReport
+class PhaseTimer
+{
+    RunStats *stats;
+    MemoryReport *memory;
+    PerfReport *perf;
+    uint64_t perfStart[PERF_EVENT_COUNT];
+    Phase phase;
+    std::chrono::steady_clock::time_point wallStart;
+    std::chrono::nanoseconds cpuStart;
+
+    PhaseTimer(const PhaseTimer&);
+    PhaseTimer& operator=(const PhaseTimer&);
+
+public:
+    explicit PhaseTimer(Phase phase);
+    ~PhaseTimer();
+};
+
+// Stream buffer that counts the bytes it passes on to another one
+class CountingBuffer : public std::streambuf
+{
+    std::streambuf *target;
+    long count;
+
+protected:
+    virtual int_type overflow(int_type ch);
+    virtual std::streamsize xsputn(const char *data, std::streamsize size);
+    virtual int sync();
+
+public:
+    explicit CountingBuffer(std::streambuf *target) : target(target), count(0) {}
+
+    long bytes() const { return count; }
+};
+
+#endif /* STATS_H_ */
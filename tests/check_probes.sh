@@ -0,0 +1,31 @@
+#!/bin/sh
+# Checks that a binary carries every tracing probe of probes.h in its
+# .note.stapsdt section, as provider:name pairs
+#
+# Usage: tests/check_probes.sh [binary], ./parser by default
+
+binary=${1:-./parser}
+if [ ! -f "$binary" ]
+then
+    echo "no binary $binary"
+    exit 1
+fi
+probes="token statement_start statement_end syntax_error error eval_entry eval_exit value_alloc"
+
+notes=$(readelf -n "$binary" | awk '
+    /^Displaying notes found in:/ { inSection = ($NF == ".note.stapsdt") }
+    inSection && $1 == "Provider:" { provider = $2 }
+    inSection && $1 == "Name:" { print provider ":" $2 }
+')
+
+missing=0
+for probe in $probes
+do
+    if ! printf '%s\n' "$notes" | grep -qx "parser:$probe"
+    then
+        echo "missing probe parser:$probe in $binary"
+        missing=1
+    fi
+done
+[ $missing -eq 0 ] && echo ok
+exit $missing
@@ -0,0 +1,195 @@
+// Makes random edits to random programs through IncrementalProgram and compares
+// its diagnostics, error flags, check result and evaluation after every edit
+// with those of Prog(), check() and Evaluate() on the whole source
+//
+// Every round is a program of up to 30 statements edited 40 times, and a last
+// one a program of 3000 statements edited 1000 times; exits with 1 if an edit
+// gave a different result, after printing the first few
+
+#include <iostream>
+#include <random>
+#include <sstream>
+using namespace std;
+
+#include "../incremental.h"
+#include "../semantic.h"
+
+static std::mt19937 generator(12345);
+
+static size_t pick(size_t n)
+{
+    return std::uniform_int_distribution<size_t>(0, n - 1)(generator);
+}
+
+// pieces of tokens, comments and strings, whole or broken
+static const char *pieces[] = {
+    "int ", "string ", "set ", "print ", "println ", "a", "b", "c", "x1", " ", "\n", "\n\n",
+    ";", ";", ";", "+", "-", "*", "/", "(", ")", "\"s\"", "\"ab c\"", "1", "23", "0", "// c\n",
+    "/* x */", "\"", "/", "$", "99999999999",
+};
+
+static const char *statements[] = {
+    "int a;", "string b;", "int c;", "set a 1+2;", "set b \"x\" * 3;", "print a;", "println b + \"q\";",
+    "set c a * (2 - 1);", "println c;", "int a;", "set a b;", "print x1;", "string x1;",
+    "set x1 \"hi\";\n println x1 / \"h\";",
+};
+
+static string snippet(int n)
+{
+    string text;
+    for (int i = 0; i < n; ++i)
+    {
+        text += pieces[pick(sizeof(pieces) / sizeof(pieces[0]))];
+    }
+    return text;
+}
+
+static string program(int n)
+{
+    string text;
+    for (int i = 0; i < n; ++i)
+    {
+        text += statements[pick(sizeof(statements) / sizeof(statements[0]))];
+        text += pick(3) == 0 ? "\n" : pick(2) ? " " : "\n\n  ";
+        if (pick(10) == 0)
+        {
+            text += "// comment ; \n";
+        }
+    }
+    return text;
+}
+
+struct Result
+{
+    string	diagnostics;
+    bool	parseErrors;
+    bool	checked;
+    int		errors;
+    string	output;
+
+    bool operator==(const Result& other) const
+    {
+        return diagnostics == other.diagnostics && parseErrors == other.parseErrors &&
+               checked == other.checked && errors == other.errors && output == other.output;
+    }
+};
+
+static void startRun(Context *context, ostream *out)
+{
+    theContext = context;
+    theOutput = out;
+    lineNumber = 0;
+    hasParseErrors = false;
+    errorCount = 0;
+}
+
+static string evaluate(const ParseTree *tree)
+{
+    std::ostringstream output;
+    theOutput = &output;
+    tree->Evaluate();
+    return output.str();
+}
+
+static Result whole(const string& source)
+{
+    Result result;
+    Context context;
+    std::ostringstream messages;
+    startRun(&context, &messages);
+    std::istringstream in(source);
+    ParseTree *tree = Prog(&in);
+    result.parseErrors = tree == 0 || hasParseErrors;
+    result.checked = !result.parseErrors && check(tree);
+    result.diagnostics = messages.str();
+    result.errors = errorCount;
+    if (result.checked)
+    {
+        result.output = evaluate(tree);
+    }
+    delete tree;
+    return result;
+}
+
+static Result incremental(IncrementalProgram& edited)
+{
+    Result result;
+    Context context;
+    std::ostringstream messages;
+    startRun(&context, &messages);
+    edited.printDiagnostics();
+    result.diagnostics = messages.str();
+    result.errors = errorCount;
+    ParseTree *tree = edited.program();
+    result.parseErrors = tree == 0 || edited.hasParseErrors();
+    result.checked = edited.isChecked();
+    if (result.checked)
+    {
+        result.output = evaluate(tree);
+    }
+    return result;
+}
+
+static void print(const char *title, const Result& result)
+{
+    cout << title << ":\n" << result.diagnostics << "parse errors " << result.parseErrors
+         << " checked " << result.checked << " errors " << result.errors << '\n' << result.output << endl;
+}
+
+struct Totals
+{
+    int		failures;
+    long	edits;
+    long	relexed;
+    long	rechecked;
+};
+
+// Makes count random edits; returns false at the first mismatch
+static bool editRandomly(IncrementalProgram& edited, int count, int round, Totals& totals)
+{
+    for (int edit = 0; edit < count; ++edit)
+    {
+        const string& source = edited.getSource();
+        size_t offset = source.empty() ? 0 : pick(source.size() + 1);
+        size_t removed = pick(4) == 0 ? pick(20) : pick(3);
+        string inserted = pick(3) == 0 ? "" : pick(4) == 0 ? program(pick(3)) : snippet(pick(4));
+        edited.edit(offset, removed, inserted);
+        ++totals.edits;
+        totals.relexed += edited.lastEdit().relexed;
+        totals.rechecked += edited.lastEdit().rechecked;
+
+        Result expected = whole(edited.getSource());
+        Result result = incremental(edited);
+        if (!(result == expected))
+        {
+            if (++totals.failures <= 3)
+            {
+                cout << "MISMATCH round " << round << " edit " << edit << ": " << removed << " bytes at "
+                     << offset << " replaced with \"" << inserted << "\"\nSOURCE:\n" << edited.getSource() << endl;
+                print("PROG", expected);
+                print("INCREMENTAL", result);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 3000;
+    Totals totals = { 0, 0, 0, 0 };
+    for (int round = 0; round < rounds; ++round)
+    {
+        IncrementalProgram edited(program(pick(30)));
+        editRandomly(edited, 40, round, totals);
+    }
+    // and a long program, so edits land deep in the tree of statements
+    IncrementalProgram edited(program(3000));
+    editRandomly(edited, 1000, rounds, totals);
+
+    cout << (totals.failures == 0 ? "ok" : "failed") << ": " << totals.edits << " edits, " << totals.failures
+         << " mismatches, " << (double)totals.relexed / totals.edits << " statements lexed and "
+         << (double)totals.rechecked / totals.edits << " checked again per edit" << endl;
+    return totals.failures != 0;
+}
@@ -0,0 +1,210 @@
+// Feeds programs to PushParser split at every byte offset and compares the
+// tree and the diagnostics with those of Prog() for the whole input
+//
+// Exits with 1 on the first mismatch, after printing the program and the split
+
+#include <iostream>
+#include <random>
+#include <sstream>
+using namespace std;
+
+#include "../pushparser.h"
+
+// Writes a tree in preorder with the lines and values of its nodes
+class TreeDump : public ParseTreeVisitor
+{
+    ostream& out;
+
+    void node(const char *kind, const ParseTree *tree)
+    {
+        out << kind << '@' << tree->getLineNumber() << ' ';
+    }
+
+public:
+    explicit TreeDump(ostream& out) : out(out) {}
+
+    virtual bool beginVisit(const StatementList *stmts) { node("list", stmts); return true; }
+    virtual bool beginVisit(const Addition *add) { node("+", add); return true; }
+    virtual bool beginVisit(const Subtraction *sub) { node("-", sub); return true; }
+    virtual bool beginVisit(const Multiplication *mul) { node("*", mul); return true; }
+    virtual bool beginVisit(const Division *div) { node("/", div); return true; }
+    virtual bool beginVisit(const PrintCommand *print)
+    {
+        node(print->IsNewline() ? "println" : "print", print);
+        return true;
+    }
+    virtual bool beginVisit(const VariableAssignment *varAssign)
+    {
+        node("set", varAssign);
+        out << varAssign->getIdentifier()->getName() << ' ';
+        return true;
+    }
+    virtual bool beginVisit(const VariableDeclaration *varDecl)
+    {
+        node(varDecl->GetType() == INT_TYPE ? "int" : "string", varDecl);
+        out << varDecl->getIdentifier()->getName() << ' ';
+        return true;
+    }
+    virtual bool beginVisit(const Identifier *id)
+    {
+        node("id", id);
+        out << id->getName() << ' ';
+        return true;
+    }
+    virtual bool beginVisit(const IntegerConstant *intConst)
+    {
+        node("iconst", intConst);
+        out << intConst->GetIntValue() << ' ';
+        return true;
+    }
+    virtual bool beginVisit(const StringConstant *strConst)
+    {
+        node("sconst", strConst);
+        out << '"' << strConst->GetStringValue() << "\" ";
+        return true;
+    }
+};
+
+struct Parse
+{
+    string tree;
+    string diagnostics;
+    bool parseErrors;
+};
+
+static string dump(const ParseTree *tree)
+{
+    if (tree == 0)
+    {
+        return "null";
+    }
+    std::ostringstream out;
+    TreeDump visitor(out);
+    tree->accept(&visitor);
+    return out.str();
+}
+
+static void startParse(ostream *out)
+{
+    theOutput = out;
+    lineNumber = 0;
+    hasParseErrors = false;
+    errorCount = 0;
+}
+
+static Parse parseWhole(const string& source)
+{
+    Parse result;
+    std::ostringstream messages;
+    startParse(&messages);
+    std::istringstream in(source);
+    ParseTree *tree = Prog(&in);
+    result.tree = dump(tree);
+    result.diagnostics = messages.str();
+    result.parseErrors = hasParseErrors;
+    delete tree;
+    return result;
+}
+
+// Pushes the source in chunks of at most chunk bytes, the first one first bytes long
+static Parse parsePushed(const string& source, size_t first, size_t chunk)
+{
+    Parse result;
+    std::ostringstream messages;
+    startParse(&messages);
+    PushParser parser;
+    size_t offset = std::min(first, source.size());
+    parser.feed(source.data(), offset);
+    while (offset < source.size())
+    {
+        size_t size = std::min(chunk, source.size() - offset);
+        parser.feed(source.data() + offset, size);
+        offset += size;
+    }
+    ParseTree *tree = parser.finish();
+    result.tree = dump(tree);
+    result.diagnostics = messages.str();
+    result.parseErrors = parser.hasErrors();
+    delete tree;
+    return result;
+}
+
+static bool same(const Parse& whole, const Parse& pushed, const string& source, const string& split)
+{
+    if (whole.tree == pushed.tree && whole.diagnostics == pushed.diagnostics &&
+        whole.parseErrors == pushed.parseErrors)
+    {
+        return true;
+    }
+    cout << "MISMATCH " << split << "\nSOURCE:\n" << source
+         << "\nPROG:\n" << whole.tree << '\n' << whole.diagnostics
+         << "\nPUSH:\n" << pushed.tree << '\n' << pushed.diagnostics << endl;
+    return false;
+}
+
+static bool testSource(const string& source)
+{
+    Parse whole = parseWhole(source);
+    for (size_t offset = 0; offset <= source.size(); ++offset)
+    {
+        if (!same(whole, parsePushed(source, offset, source.size()), source, "at " + std::to_string(offset)))
+        {
+            return false;
+        }
+    }
+    return same(whole, parsePushed(source, 0, 1), source, "byte by byte");
+}
+
+static const char *programs[] = {
+    "",
+    "int a;",
+    "int a;\nset a 1 + 2 * (3 - 4) / 5;\nprintln a;\n",
+    "string s; set s \"a;b\" + \"c\\\"d\"; print s * 3;",
+    "// comment ; with a semicolon\nint x1; /* block ; */ set x1 42;\nprintln x1",
+    "int a; set a 99999999999;",
+    "int a;\n\nset a (1 + ;\nprintln a;",
+    "int a; set a ((2 * (1 + ;) ) print a;",
+    "print (((;",
+    "print (1) + ((2));\nprint 3;",
+    "print \"unterminated;\n",
+    "int a; set a 1 $ 2;",
+    "println \"trailing\"; int",
+    "int a; set a 1;;",
+    "/* never closed ; int b;",
+};
+
+static const char *pieces[] = {
+    "int ", "string ", "set ", "print ", "println ", "a", "b", "x1", " ", "\n", ";", ";", "+", "-", "*",
+    "/", "(", ")", "\"s\"", "\"a;b\"", "1", "23", "// c\n", "/* ; */", "\"", "$",
+};
+
+int main(int argc, char **argv)
+{
+    int randomPrograms = argc > 1 ? atoi(argv[1]) : 300;
+
+    for (size_t i = 0; i < sizeof(programs) / sizeof(programs[0]); ++i)
+    {
+        if (!testSource(programs[i]))
+        {
+            return 1;
+        }
+    }
+
+    std::mt19937 random(1);
+    std::uniform_int_distribution<size_t> piece(0, sizeof(pieces) / sizeof(pieces[0]) - 1);
+    std::uniform_int_distribution<int> length(0, 24);
+    for (int i = 0; i < randomPrograms; ++i)
+    {
+        string source;
+        for (int n = length(random); n > 0; --n)
+        {
+            source += pieces[piece(random)];
+        }
+        if (!testSource(source))
+        {
+            return 1;
+        }
+    }
+    cout << "ok" << endl;
+    return 0;
+}
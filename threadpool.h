@@ -0,0 +1,89 @@
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running submitted tasks in submission order
+// The destructor lets the workers finish every queued task before joining them
+class ThreadPool
+{
+    std::vector<std::thread>			workers;
+    std::deque<std::function<void()> >	tasks;
+    std::mutex							lock;
+    std::condition_variable				wakeup;
+    bool								stopping;
+
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    void work()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                while (tasks.empty() && !stopping)
+                {
+                    wakeup.wait(guard);
+                }
+                if (tasks.empty())
+                {
+                    return;
+                }
+                task.swap(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    // threads == 0 means one worker per hardware thread
+    explicit ThreadPool(unsigned threads = 0) : stopping(false)
+    {
+        if (threads == 0)
+        {
+            threads = std::thread::hardware_concurrency();
+        }
+        if (threads == 0)
+        {
+            threads = 1;
+        }
+        for (unsigned i = 0; i < threads; ++i)
+        {
+            workers.push_back(std::thread(&ThreadPool::work, this));
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (size_t i = 0; i < workers.size(); ++i)
+        {
+            workers[i].join();
+        }
+    }
+
+    size_t size() const { return workers.size(); }
+
+    void submit(const std::function<void()>& task)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            tasks.push_back(task);
+        }
+        wakeup.notify_one();
+    }
+};
+
+#endif /* THREADPOOL_H_ */
@@ -0,0 +1,203 @@
+#include <cstdint>
+#include <cstring>
+
+#include "utf8.h"
+
+bool validUtf8Scalar(const char *data, size_t size)
+{
+    const unsigned char *next = (const unsigned char*)data;
+    const unsigned char *end = next + size;
+    while (next < end)
+    {
+        uint64_t word;
+        if (end - next >= 8 && (memcpy(&word, next, 8), (word & 0x8080808080808080ULL) == 0))
+        {
+            next += 8;
+            continue;
+        }
+        unsigned char lead = *next;
+        if (lead < 0x80)
+        {
+            ++next;
+            continue;
+        }
+        // the length of the character, and the range of its second byte,
+        // narrower after the leads of overlong forms, surrogates and too large values
+        size_t length;
+        unsigned char low = 0x80, high = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF)
+        {
+            length = 2;
+        }
+        else if (lead >= 0xE0 && lead <= 0xEF)
+        {
+            length = 3;
+            low = lead == 0xE0 ? 0xA0 : low;
+            high = lead == 0xED ? 0x9F : high;
+        }
+        else if (lead >= 0xF0 && lead <= 0xF4)
+        {
+            length = 4;
+            low = lead == 0xF0 ? 0x90 : low;
+            high = lead == 0xF4 ? 0x8F : high;
+        }
+        else
+        {
+            return false;
+        }
+        if ((size_t)(end - next) < length || next[1] < low || next[1] > high)
+        {
+            return false;
+        }
+        for (size_t i = 2; i < length; ++i)
+        {
+            if ((next[i] & 0xC0) != 0x80)
+            {
+                return false;
+            }
+        }
+        next += length;
+    }
+    return true;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(NO_SIMD_UTF8)
+
+#include <immintrin.h>
+
+#define UTF8_SSSE3 __attribute__((target("ssse3")))
+
+// The errors a byte and the one before it can make, a bit each; a pair is
+// invalid if the bits its first byte's high and low nibble and the second
+// byte's high nibble select have one in common, except that a continuation
+// must follow a lead two or three bytes back, where TWO_CONTS is expected
+const uint8_t TOO_SHORT = 1 << 0;		// 11______ 0_______, 11______ 11______
+const uint8_t TOO_LONG = 1 << 1;		// 0_______ 10______
+const uint8_t OVERLONG_3 = 1 << 2;		// 11100000 100_____
+const uint8_t TOO_LARGE = 1 << 3;		// 11110100 1001____ and above
+const uint8_t SURROGATE = 1 << 4;		// 11101101 101_____
+const uint8_t OVERLONG_2 = 1 << 5;		// 1100000_ 10______
+const uint8_t TOO_LARGE_1000 = 1 << 6;	// 11110101 1000____ and above
+const uint8_t OVERLONG_4 = 1 << 6;		// 11110000 1000____
+const uint8_t TWO_CONTS = 1 << 7;		// 10______ 10______
+const uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+static const uint8_t firstHighNibble[16] = {
+    // ASCII
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    // continuation
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    // leads of two, three and four bytes
+    TOO_SHORT | OVERLONG_2,
+    TOO_SHORT,
+    TOO_SHORT | OVERLONG_3 | SURROGATE,
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+};
+
+static const uint8_t firstLowNibble[16] = {
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    CARRY | OVERLONG_2,
+    CARRY,
+    CARRY,
+    CARRY | TOO_LARGE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000
+};
+
+static const uint8_t secondHighNibble[16] = {
+    // ASCII
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    // continuations 1000____, 1001____ and 101_____
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    // leads
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+};
+
+// The bytes of a block that are errors, given the block before it
+UTF8_SSSE3 static __m128i blockErrors(__m128i input, __m128i previous)
+{
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+    __m128i firstHigh = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)firstHighNibble),
+                                         _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+    __m128i firstLow = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)firstLowNibble), _mm_and_si128(prev1, nibble));
+    __m128i secondHigh = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)secondHighNibble),
+                                          _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+    __m128i special = _mm_and_si128(_mm_and_si128(firstHigh, firstLow), secondHigh);
+    // the third and fourth bytes of a character: 111_____ two back or 1111____ three back
+    __m128i third = _mm_subs_epu8(_mm_alignr_epi8(input, previous, 14), _mm_set1_epi8((char)(0xE0 - 0x80)));
+    __m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(input, previous, 13), _mm_set1_epi8((char)(0xF0 - 0x80)));
+    __m128i continued = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char)0x80));
+    return _mm_xor_si128(continued, special);
+}
+
+UTF8_SSSE3 static bool validUtf8Ssse3(const char *data, size_t size)
+{
+    // among the last three bytes of a block, those starting a character that needs more bytes
+    const __m128i lastLeads = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                            (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    __m128i errors = _mm_setzero_si128();
+    __m128i previous = _mm_setzero_si128();
+    __m128i incomplete = _mm_setzero_si128();
+    // the last partial block is padded with zeros, which end any character too soon
+    char tail[16];
+    for (size_t offset = 0; offset < size; offset += 16)
+    {
+        const char *block = data + offset;
+        if (size - offset < 16)
+        {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, block, size - offset);
+            block = tail;
+        }
+        __m128i input = _mm_loadu_si128((const __m128i*)block);
+        if (_mm_movemask_epi8(input) == 0)
+        {
+            // an ASCII block only has to finish the character the last one started
+            errors = _mm_or_si128(errors, incomplete);
+        }
+        else
+        {
+            errors = _mm_or_si128(errors, blockErrors(input, previous));
+            incomplete = _mm_subs_epu8(input, lastLeads);
+        }
+        previous = input;
+    }
+    errors = _mm_or_si128(errors, incomplete);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(errors, _mm_setzero_si128())) == 0xFFFF;
+}
+
+typedef bool (*Validator)(const char *data, size_t size);
+
+static Validator chooseValidator()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3") ? validUtf8Ssse3 : validUtf8Scalar;
+}
+
+bool validUtf8(const char *data, size_t size)
+{
+    static const Validator validator = chooseValidator();
+    return validator(data, size);
+}
+
+#else
+
+bool validUtf8(const char *data, size_t size)
+{
+    return validUtf8Scalar(data, size);
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef UTF8_H_
+#define UTF8_H_
+
+#include <cstddef>
+
+// Validation of the bytes of string constants as UTF-8 (RFC 3629): no
+// overlong forms, no surrogates, nothing above U+10FFFF, no stray or missing
+// continuation bytes
+//
+// On x86-64 with SSSE3, checked once at startup, 16 bytes are validated at a
+// time with the lookup tables of Keiser and Lemire, "Validating UTF-8 In Less
+// Than One Instruction Per Byte": three shuffles classify every pair of
+// adjacent bytes, and all-ASCII blocks only take a test of their high bits.
+// Elsewhere, and when built with -DNO_SIMD_UTF8, bytes are validated one
+// character at a time, with ASCII taken eight bytes at a time.
+
+extern bool validUtf8(const char *data, size_t size);
+
+// The scalar validator, which the lexer's cross-check compares against
+extern bool validUtf8Scalar(const char *data, size_t size);
+
+#endif /* UTF8_H_ */
@@ -0,0 +1,219 @@
+#ifndef WORKSTEALING_H_
+#define WORKSTEALING_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool for fork-join parallelism
+//
+// Every worker has its own deque: it pushes and pops its own tasks at the back,
+// while idle workers steal from the front of the others. Tasks submitted from
+// outside the pool go to a shared queue. A thread joining a forked task keeps
+// running queued tasks until the one it waits for is finished, so tasks may
+// fork and join nested tasks without ever blocking a worker.
+class WorkStealingPool
+{
+public:
+    // A unit of work that is forked and later joined by the thread that forked it
+    class Task
+    {
+        friend class WorkStealingPool;
+
+        std::function<void()>	body;
+        std::atomic<bool>		finished;
+        // owned tasks come from submit() and are deleted once they ran
+        bool					owned;
+
+    public:
+        explicit Task(const std::function<void()>& body = std::function<void()>())
+                : body(body), finished(false), owned(false)
+        {
+        }
+    };
+
+    // threads == 0 means one worker per hardware thread
+    explicit WorkStealingPool(unsigned threads = 0)
+            : queued(0), stopping(false)
+    {
+        if (threads == 0)
+        {
+            threads = std::thread::hardware_concurrency();
+        }
+        if (threads == 0)
+        {
+            threads = 1;
+        }
+        // the last queue takes the tasks submitted from outside the pool
+        for (unsigned i = 0; i <= threads; ++i)
+        {
+            queues.push_back(std::unique_ptr<Queue>(new Queue()));
+        }
+        for (unsigned i = 0; i < threads; ++i)
+        {
+            workers.push_back(std::thread(&WorkStealingPool::work, this, (int)i));
+        }
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (size_t i = 0; i < workers.size(); ++i)
+        {
+            workers[i].join();
+        }
+    }
+
+    size_t size() const { return workers.size(); }
+
+    // Runs task on some worker; nobody waits for it
+    void submit(const std::function<void()>& body)
+    {
+        Task *task = new Task(body);
+        task->owned = true;
+        push(task);
+    }
+
+    // Makes task available to other workers; it must be joined before it goes away
+    void fork(Task& task)
+    {
+        task.finished.store(false, std::memory_order_relaxed);
+        push(&task);
+    }
+
+    // Waits for a forked task, running it or other queued tasks in the meantime
+    void join(Task& task)
+    {
+        while (!task.finished.load(std::memory_order_acquire))
+        {
+            if (!runOne())
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex			lock;
+        std::deque<Task*>	tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue> >	queues;
+    std::vector<std::thread>				workers;
+    std::atomic<int>						queued;
+    std::mutex								sleepLock;
+    std::condition_variable					wakeup;
+    bool									stopping;
+
+    // the pool the current thread works for, and its queue there
+    static thread_local WorkStealingPool	*currentPool;
+    static thread_local int					currentQueue;
+
+    WorkStealingPool(const WorkStealingPool&);
+    WorkStealingPool& operator=(const WorkStealingPool&);
+
+    int ownQueue() const
+    {
+        return currentPool == this ? currentQueue : (int)workers.size();
+    }
+
+    void push(Task *task)
+    {
+        Queue& queue = *queues[ownQueue()];
+        {
+            std::lock_guard<std::mutex> guard(queue.lock);
+            queue.tasks.push_back(task);
+        }
+        queued.fetch_add(1);
+        std::lock_guard<std::mutex> guard(sleepLock);
+        wakeup.notify_one();
+    }
+
+    // own tasks newest first, everybody else's oldest first
+    Task* take()
+    {
+        int own = ownQueue();
+        size_t count = queues.size();
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t index = (own + i) % count;
+            Queue& queue = *queues[index];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (queue.tasks.empty())
+            {
+                continue;
+            }
+            Task *task;
+            if ((int)index == own && own != (int)workers.size())
+            {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            }
+            else
+            {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+            }
+            queued.fetch_sub(1);
+            return task;
+        }
+        return 0;
+    }
+
+    bool runOne()
+    {
+        Task *task = take();
+        if (task == 0)
+        {
+            return false;
+        }
+        task->body();
+        if (task->owned)
+        {
+            delete task;
+        }
+        else
+        {
+            task->finished.store(true, std::memory_order_release);
+        }
+        return true;
+    }
+
+    void work(int index)
+    {
+        currentPool = this;
+        currentQueue = index;
+        for (;;)
+        {
+            if (runOne())
+            {
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(sleepLock);
+            while (queued.load() == 0 && !stopping)
+            {
+                wakeup.wait(guard);
+            }
+            if (stopping && queued.load() == 0)
+            {
+                return;
+            }
+        }
+    }
+};
+
+inline thread_local WorkStealingPool *WorkStealingPool::currentPool = 0;
+inline thread_local int WorkStealingPool::currentQueue = 0;
+
+#endif /* WORKSTEALING_H_ */